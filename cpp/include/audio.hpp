@@ -0,0 +1,101 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#define AUDIO_RATE 48000
+#define AUDIO_RING 8192
+#define AUDIO_VOLUME 4000
+
+// single producer/single consumer queue. the emulator pushes and the SDL audio
+// thread pops, so neither side ever has to take a lock. size must be a power
+// of 2
+template <typename T, size_t size> class RingBuffer {
+  public:
+    bool push(T value) {
+        auto head = write.load(std::memory_order_relaxed);
+        if (head - read.load(std::memory_order_acquire) == size) {
+            return false;
+        }
+        buf[head & (size - 1)] = value;
+        write.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        auto tail = read.load(std::memory_order_relaxed);
+        if (tail == write.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = buf[tail & (size - 1)];
+        read.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t count() const {
+        return write.load(std::memory_order_acquire) -
+               read.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::array<T, size> buf;
+    std::atomic<size_t> write{ 0 };
+    std::atomic<size_t> read{ 0 };
+};
+
+// Audio turns the sound timer into samples. samples are generated in emulated
+// time, one timer tick worth at a time, and are then either queued for the
+// SDL device or written to a wav file (or both)
+class Audio {
+  public:
+    Audio();
+    ~Audio();
+
+    bool open();
+    bool record(std::string path);
+    void close();
+
+    bool   playing() const;
+    size_t queued() const;
+
+    // resample ratio for samples sent to the device. > 1 produces slightly
+    // more samples per tick to refill the device queue
+    void setRatio(double r);
+
+    // generates count samples. while on is false silence is produced. with
+    // usePattern set the XO-CHIP pattern buffer is played at the given pitch,
+    // otherwise a plain square wave
+    void generate(int                           count,
+                  bool                          on,
+                  const std::array<uint8_t, 16>& pattern,
+                  bool                          usePattern,
+                  uint8_t                       pitch);
+
+  private:
+    RingBuffer<int16_t, AUDIO_RING> ring;
+
+    // one tick worth of samples, kept so generating doesn't allocate
+    std::vector<int16_t> samples;
+
+    SDL_AudioDeviceID device;
+
+    std::ofstream wav;
+    uint32_t      wavSamples;
+
+    double phase;
+    double ratio;
+    double frac;
+
+    void finishWav();
+
+    static void callback(void* userdata, Uint8* stream, int len);
+};
+
+#endif
@@ -2,61 +2,532 @@
 #define CHIP8_H
 
 #include <array>
-#include <map>
+#include <coroutine>
+#include <ostream>
+#include <random>
 #include <string>
 #include <vector>
 
 #include <SDL2/SDL.h>
 
+#include "audio.hpp"
+#include "ipc.hpp"
+#include "metrics.hpp"
+#include "pacer.hpp"
+#include "scaler.hpp"
+#include "tracefile.hpp"
+#include "video.hpp"
+
 #define PROGRAM_MEM_START 0x200
+#define MEM_SIZE 0x10000
+
+#define TIMER_RATE 60
+#define CYCLES_PER_FRAME 10
 
 #define D_WIDTH 64
 #define D_HEIGHT 32
 
+// XO-CHIP bitplanes. a pixel's color is the combination of its bit in each
+// plane, giving 4 colors with 2 planes
+#define PLANES 2
+
 typedef uint8_t byte;
 
+// what the core does when a rom does something with no defined behavior:
+// overflowing or underflowing the stack, reading or writing memory past
+// 0xFFFF, or running off the end of memory.
+//   Checked:   stops the machine with a fault naming the pc and opcode, for
+//              fuzzing and untrusted roms
+//   Unchecked: wraps around (sp within the stack, addresses at 16 bits)
+//              with no branches, for trusted roms
+// the interpreter is built for both policies. each instance picks one, so
+// the explorer can hunt for crashes with a Checked machine in the same
+// binary that plays with an Unchecked one
+struct Checked {
+    static constexpr bool traps = true;
+};
+
+struct Unchecked {
+    static constexpr bool traps = false;
+};
+
+enum class Safety : byte { Checked, Unchecked };
+
+// instruction sequences that are executed as a single macro-op
+//   DrawSetup: 6XKK 6YKK ANNN DXYN
+//   CountLoop: 7XKK 3XKK 1NNN
+//   DelayLoop: FX07 3X00 1NNN
+enum class Fusion : byte { Unknown, None, DrawSetup, CountLoop, DelayLoop };
+
+// everything needed to put the machine back exactly where it was, including
+// the rng so that replayed frames make the same choices. it is plain data so
+// saving and restoring are straight copies
+struct State {
+    std::array<byte, MEM_SIZE>                         memory;
+    std::array<uint16_t, 16>                           stack;
+    std::array<byte, 16>                               v;
+    std::array<std::array<uint64_t, D_HEIGHT>, PLANES> display;
+    std::array<byte, 16>                               pattern;
+    uint16_t                                           keys;
+
+    byte     sp, dt, st;
+    byte     plane, pitch;
+    uint16_t pc;
+    uint16_t i;
+    bool     patternLoaded;
+
+    std::minstd_rand0 gen;
+
+    uint64_t memoryHash;
+    uint64_t displayHash;
+};
+
+class Chip8;
+class Debugger;
+class Hooks;
+class Netplay;
+
+// why Chip8::execute() handed control back to its host
+//   Frame:   a frame finished, and timers ticked
+//   KeyWait: FX0A found no key down. it runs again when resumed, so a host
+//            can sleep until its next key event or frame deadline
+//   Break:   the debugger stopped execution
+enum class Yield : byte { Frame, KeyWait, Break };
+
+// the coroutine returned by Chip8::execute(). resume() runs the machine up to
+// the next yield and returns false once it has stopped. it can also be
+// co_awaited from a host coroutine, which gives the next Yield
+class Execution {
+  public:
+    struct promise_type {
+        Yield last{ Yield::Frame };
+
+        Execution get_return_object() {
+            return Execution{
+                std::coroutine_handle<promise_type>::from_promise(*this)
+            };
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+        std::suspend_always yield_value(Yield y) {
+            last = y;
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() {
+            throw;
+        }
+    };
+
+    explicit Execution(std::coroutine_handle<promise_type> handle)
+        : handle{ handle } {}
+    Execution(Execution&& other) : handle{ other.handle } {
+        other.handle = nullptr;
+    }
+    Execution(const Execution&) = delete;
+    Execution& operator=(Execution&& other) {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle       = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+    ~Execution() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool resume() {
+        if (!handle || handle.done()) {
+            return false;
+        }
+        handle.resume();
+        return !handle.done();
+    }
+
+    Yield event() const {
+        return handle.promise().last;
+    }
+
+    // true once the machine has stopped, after which a new execute() is
+    // needed to run it again
+    bool done() const {
+        return !handle || handle.done();
+    }
+
+    // resumes synchronously, there is nothing to wait for
+    auto operator co_await() {
+        struct Awaiter {
+            Execution& execution;
+
+            bool await_ready() {
+                execution.resume();
+                return true;
+            }
+            void  await_suspend(std::coroutine_handle<>) {}
+            Yield await_resume() {
+                return execution.event();
+            }
+        };
+        return Awaiter{ *this };
+    }
+
+  private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+// set of program counters reached, for coverage guided exploration. touched
+// lists every address in the order it was first seen so the set can be
+// cleared (or merged somewhere else) without scanning all of memory
+struct Coverage {
+    std::array<bool, MEM_SIZE> seen{};
+    std::vector<uint16_t>      touched;
+
+    void hit(uint16_t pc) {
+        if (!seen[pc]) {
+            seen[pc] = true;
+            touched.push_back(pc);
+        }
+    }
+
+    void clear() {
+        for (auto pc : touched) {
+            seen[pc] = false;
+        }
+        touched.clear();
+    }
+};
+
+// generated code is a specialization of Aot for the hash of its rom, so any
+// number of compiled roms can be linked into one binary
+template <uint64_t hash> struct Aot;
+
+// ahead of time compiled code for a single rom, produced by chip8-aot. run
+// executes compiled blocks starting at pc until it reaches code it doesn't
+// know or the budget runs out, and returns the number of instructions
+// retired. ranges lists the [start, end) address pairs of every compiled
+// instruction
+struct CompiledRom {
+    uint64_t        hash;
+    int (*run)(Chip8& c, int budget);
+    const uint16_t* ranges;
+    int             count;
+};
+
 class Chip8 {
+    template <uint64_t hash> friend struct Aot;
+    friend class HookContext;
+    friend class Hooks;
+
   public:
-    Chip8(std::string rom, int scale);
+    // cached looks for (and leaves behind) what loading the rom works out in
+    // ~/.chip8/cache, see romcache.hpp
+    Chip8(std::string rom,
+          int         scale,
+          bool        cached = true,
+          Safety      safety = Safety::Checked);
 
     void run();
+
+    // inputs are key masks for each frame, as with runDiff. without any the
+    // keys are left alone. with netplay they are this side's presses
+    void runHeadless(int frames, const std::vector<uint16_t>& inputs);
+
+    // runs without a window for a front end in another process, publishing
+    // to and taking commands from the shared memory until told to quit
+    void serve(SharedMemory& shm);
+    void frame();
+
+    // runs the machine as a coroutine for hosts that own their event loop.
+    // it suspends at every frame boundary, key wait and debugger stop, and
+    // finishes when the machine stops
+    Execution execute();
     void reset();
     bool load();
+    bool isLoaded() const;
+    bool record(std::string path);
+    void setPacing(Pacing p);
+    void setFrameDelay(int ms);
+    void setRunAhead(int frames);
 
-  private:
-    std::array<byte, 0x1000> memory;
-    std::array<uint16_t, 16> stack;
-    std::array<byte, 16>     v;
+    // how the display is scaled up when there is no gpu renderer (sleep or
+    // audio pacing, or no accelerated renderer available)
+    void setUpscale(Upscale mode);
 
-    std::array<std::array<byte, D_WIDTH>, D_HEIGHT> display;
+    // shows frame rate, frame times and a frame time graph over the display,
+    // with the full numbers in the window title
+    void setOverlay(bool on);
 
-    std::vector<std::string> romPaths;
-    std::map<byte, byte>     keys;
+    // a line of json metrics is written here every METRICS_PERIOD while
+    // running in a window or serving, if non null
+    void setMetricsLog(std::ostream* out);
 
-    byte sp, dt, st;
+    State save() const;
+    void  restore(const State& state);
+
+    static bool registerCompiled(CompiledRom compiled);
+
+    // sets the keypad from a bitmask, bit n being key n
+    void setKeys(uint16_t mask);
+
+    // presses keys on top of any not yet taken, as a key event would
+    void pressKeys(uint16_t mask);
+
+    // seeds the rng behind CXKK
+    void setSeed(uint32_t seed);
+
+    // skips generating audio, for instances nobody listens to
+    void setMuted(bool mute);
+
+    // marks frames that are going to be rewound (run-ahead, netplay
+    // rollbacks), which hooks don't fire for
+    void setSpeculative(bool on);
+
+    // the packed display, a word per row with the msb as the leftmost pixel
+    const std::array<std::array<uint64_t, D_HEIGHT>, PLANES>& screen() const;
+
+    // runs headless for differential testing against another core. inputs[f]
+    // is the key mask for frame f, and every n instructions a line of
+    // "count pc i hash" is written to out, hash being a running hash of the
+    // machine state (see traceHash). the interpreter is used exclusively when
+    // interpret is set or lines don't fall on frame boundaries
+    void runDiff(std::ostream&                out,
+                 int                          frames,
+                 int                          every,
+                 const std::vector<uint16_t>& inputs,
+                 bool                         interpret);
+
+    // runs headless for frames and writes a summary of the rom for front
+    // ends to catalog it, one "key value" line each:
+    //   hash     fnv1a of the rom, in hex
+    //   size     bytes
+    //   profile  chip-8, schip or xo-chip, from the instructions it ran
+    //   display  the packed display afterwards as hex words, plane by plane
+    //            and row by row
+    void describe(std::ostream& out, int frames);
+
+    // coverage is collected into the given set while it is non null. the
+    // interpreter is used exclusively while collecting
+    void setCoverage(Coverage* coverage);
+
+    // every instruction executed is recorded to the writer while it is non
+    // null, starting from the current state. as with coverage, only the
+    // interpreter is used while tracing
+    void setTrace(TraceWriter* trace);
+
+    // every emulated frame's display is handed to the writer while it is
+    // non null. the writer skips frames and encodes on its own thread
+    void setVideo(VideoWriter* video);
+
+    // frames are run through the session while it is non null, with this
+    // side's key presses as its input. see netplay.hpp
+    void setNetplay(Netplay* netplay);
+
+    // breakpoints and stepping. a debugger with nothing set costs nothing,
+    // anything else runs the interpreter one instruction at a time. when
+    // execution stops part way through a frame, frame() returns early and
+    // carries on from the same spot next time
+    void setDebugger(Debugger* debugger);
+
+    // callbacks on addresses and opcodes, see hooks.hpp
+    void setHooks(Hooks* hooks);
+
+    // the reason execution was stopped, or null. a fault is raised for
+    // anything the rom does that has no defined behavior (such as over or
+    // underflowing the stack) and stops the machine
+    const char* fault() const;
+    uint16_t    faultAt() const;
+
+    // clears any fault and marks the machine as running, for driving frame()
+    // directly rather than through run() or runHeadless()
+    void resume();
+
+    // 64 bit hash of the whole machine state. memory and the display are
+    // hashed incrementally as they are written so this is O(1)
+    uint64_t stateHash() const;
+
+  private:
+    // the state a DXYN heavy loop keeps touching, packed together. the
+    // registers, stack, timers and keypad fit a single cache line and the
+    // display starts on the next one
+    alignas(64) std::array<byte, 16> v;
+    std::array<uint16_t, 16>         stack;
 
     uint16_t pc;
     uint16_t i;
 
+    byte sp, dt, st;
+    byte plane, pitch;
+
+    // bit n is set while key n is down
+    uint16_t keys;
+
+    // each display row is packed into a single word per plane. the msb is
+    // the leftmost pixel so a sprite byte lines up with a shift/rotate
+    alignas(64) std::array<std::array<uint64_t, D_HEIGHT>, PLANES> display;
+
+    // zobrist style hashes of memory and the display, kept up to date on
+    // every write
+    uint64_t memoryHash;
+    uint64_t displayHash;
+
+    std::array<byte, MEM_SIZE> memory;
+
+    // XO-CHIP audio pattern buffer (F002) and playback pitch (FX3A)
+    std::array<byte, 16> pattern;
+
+    // fusion found at each address, filled in lazily as code is executed and
+    // reset to Unknown around any write to memory
+    std::array<Fusion, MEM_SIZE> fusion;
+
+    // compiled code for the loaded rom, if any was linked in. it is dropped
+    // as soon as the rom writes over one of its own compiled instructions,
+    // and taken up again by restoring a state whose code matches it (which
+    // codeHash, the hash of the compiled ranges as loaded, tells)
+    const CompiledRom*       compiled;
+    const CompiledRom*       romCompiled;
+    uint64_t                 codeHash;
+    std::array<bool, MEM_SIZE> compiledCode;
+
+    std::minstd_rand0 gen;
+
     std::string rom;
+    int         romSize;
+    uint64_t    romHash;
 
     bool        loaded;
     bool        running;
+    bool        patternLoaded;
+    bool        muted;
+    bool        checked;
+    bool        speculative;
+    bool        cached;
+
+    // set when FX0A found no key down, for execute()
+    bool        keyWait;
 
     int         scale;
+    int         cycles;
+    int         frameDelay;
+    int         runAhead;
+
+    Coverage*    coverage;
+    TraceWriter* trace;
+    VideoWriter* video;
+    Netplay*     netplay;
+    Debugger*    debugger;
+    Hooks*       hooks;
+
+    // whether the compiled code has hooked instructions, as of the hooks'
+    // version and the compiled code it was worked out for
+    uint32_t           hooksSeen;
+    const CompiledRom* hooksCompiled;
+    bool               compiledHooked;
+
+    // instructions already run in the current frame
+    int frameCycle;
+
+    // instructions run in total, for metrics
+    uint64_t retired;
+
+    Metrics       metrics;
+    std::ostream* metricsLog;
+    bool          overlay;
+
+    const char* faultReason;
+    uint16_t    faultPc;
+    uint16_t    faultOp;
 
-    SDL_Window*  window;
-    SDL_Surface* surface;
+    Audio  audio;
+    Pacing pacing;
+    Scaler scaler;
+
+    SDL_Window*   window;
+    SDL_Surface*  surface;
+    SDL_Renderer* renderer;
+    SDL_Texture*  texture;
+
+    // input to photon latency. the time of the first unanswered key press
+    // is held until a present actually changes what is on screen
+    std::array<std::array<uint64_t, D_HEIGHT>, PLANES> presented;
+
+    Uint32 inputTime;
+    bool   inputPending;
+
+    // keys pressed since the run loop last took them
+    uint16_t pressed;
+    int    latencyCount;
+    Uint32 latencyTotal;
+    Uint32 latencyWorst;
 
     void init();
+
+    // tick(), sprite() and runCycles() without a policy use the instance's
     void tick();
+    template <typename Policy> void tick();
+    template <typename Policy> int  step(int budget);
+    void runNetplay(int frames, const std::vector<uint16_t>& inputs);
     void draw();
+    void drawOverlay();
+    void fillOverlay(const SDL_Rect* rects, int count, Uint32 rgb);
+    void sampleMetrics();
+    int  pixel(int x, int y);
     void handleOp();
     void handleEvents();
+    void skip();
+
+    bool keyDown(byte key) const {
+        return key < 16 && (keys >> key) & 0x1;
+    }
+    void sprite(byte x, byte y, byte n);
+    template <typename Policy> void sprite(byte x, byte y, byte n);
+    void scrollUp(byte n);
+    void scrollDown(byte n);
+    void scrollLeft();
+    void scrollRight();
+
+    void stepTimers();
+
+    uint16_t opAt(uint16_t addr);
+    Fusion   decodeFusion(uint16_t addr);
+    void     invalidate(uint16_t addr, int len);
+    void     attachCompiled(int size);
+    uint64_t hashCode(const std::array<byte, MEM_SIZE>& from) const;
+    bool     hookedWithin(uint16_t addr, int count);
+    bool     hookedCompiled();
+    void     analyse();
+    bool     freshMemory() const;
+
+    void poke(uint16_t addr, byte value);
+    void setRow(byte p, byte r, uint64_t value);
+    void rehash();
+    void rehashDisplay();
+
+    uint64_t traceHash(uint64_t hash) const;
+
+    void trackLatency();
+    void trap(const char* reason, uint16_t op);
 
-    void handleTimers(double delta, double rate);
+    // false, with a fault raised, if Policy traps and len bytes from addr
+    // run past the end of memory
+    template <typename Policy>
+    bool inMemory(uint16_t addr, int len, uint16_t op);
+    void reportFault();
+    void reportBreak();
+    Yield runCycles();
+    template <typename Policy> Yield runCycles();
+    void  endFrame();
 
-    byte waitForInput();
+    void publish(SharedMemory& shm, uint64_t frame);
+    bool handleCommand(const Command& command);
 };
 
 #endif
@@ -0,0 +1,101 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "chip8.hpp"
+
+enum class Compare : byte { Equal, NotEqual, Less, Greater };
+
+// a test on a register that has to pass for a breakpoint to stop
+struct Condition {
+    byte    reg;
+    Compare compare;
+    byte    value;
+
+    bool holds(const std::array<byte, 16>& v) const;
+};
+
+enum class StepMode : byte { None, Into, Over, Out };
+
+// breakpoints, watchpoints and stepping. the emulator only asks the debugger
+// about each instruction while it is armed, so with nothing set the normal
+// (fused and compiled) path runs at full speed
+class Debugger {
+  public:
+    Debugger();
+
+    void setBreakpoint(uint16_t addr);
+    void setBreakpoint(uint16_t addr, Condition condition);
+    void clearBreakpoint(uint16_t addr);
+
+    // parses addr or addr:VX op NN, op being one of == != < >. all numbers
+    // are hex
+    bool addBreakpoint(std::string spec);
+
+    void watch(uint16_t addr, int len = 1);
+    void unwatch(uint16_t addr, int len = 1);
+
+    // parses addr or addr:len, in hex
+    bool addWatch(std::string spec);
+
+    void pause();
+    void resume();
+    void stepInto();
+    void stepOver(uint16_t pc, uint16_t op, byte sp);
+    void stepOut(byte sp);
+
+    bool paused() const {
+        return halted;
+    }
+
+    bool armed() const {
+        return breakCount > 0 || watchCount > 0 || halted || skip ||
+               mode != StepMode::None;
+    }
+
+    // called before every instruction while armed. returns true if execution
+    // has to stop before it
+    bool check(uint16_t pc, byte sp, const std::array<byte, 16>& v);
+
+    bool watched(uint16_t addr) const {
+        return watches[addr];
+    }
+
+    // a write to a watched address. execution stops before the next
+    // instruction
+    void written(uint16_t addr, byte old, byte value);
+
+    // why execution last stopped, given once per stop
+    std::string takeMessage();
+
+  private:
+    // one bit per address. conditions are only looked up for addresses with
+    // their bit set
+    std::array<uint64_t, MEM_SIZE / 64>        breaks;
+    std::map<uint16_t, std::vector<Condition>> conditions;
+    int                                        breakCount;
+
+    // shadow of memory marking the bytes whose writes stop execution
+    std::array<bool, MEM_SIZE> watches;
+    int                        watchCount;
+
+    bool halted;
+
+    // lets the instruction execution stopped on run when continuing
+    bool skip;
+
+    StepMode mode;
+    uint16_t target;
+    byte     depth;
+
+    std::string message;
+
+    bool halt(std::string why);
+};
+
+#endif
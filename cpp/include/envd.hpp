@@ -0,0 +1,89 @@
+#ifndef ENVD_H
+#define ENVD_H
+
+#include <array>
+#include <cstdint>
+
+// protocol for chip8-envd, which runs many headless instances of one rom as
+// environments for reinforcement learning (gym style). a client connects to
+// the unix socket, says hello and maps the shared memory named in the reply.
+// every other request works on a batch of environments at once so one round
+// trip covers all of them:
+//
+//   Reset   puts each environment back to its state right after loading,
+//           with the rng seeded from its slot
+//   Step    sets each environment's keys from its slot and runs it for the
+//           request's frames
+//   Observe just refreshes the observations
+//
+// requests are an EnvRequest followed by count EnvSlots, and each gets back
+// a single EnvReply once the observations of all the environments it named
+// are in the shared memory. nothing but the reply goes over the socket
+//
+// this header is meant to be copied into clients so it doesn't depend on
+// chip8.hpp
+
+#define ENVD_MAGIC 0x43384556
+#define ENVD_VERSION 1
+
+#define ENVD_WIDTH 64
+#define ENVD_HEIGHT 32
+#define ENVD_PLANES 2
+#define ENVD_NAME 64
+
+// most environments and frames a single request may ask for
+#define ENVD_MAX_ENVS 4096
+#define ENVD_MAX_FRAMES 600
+
+enum class EnvOp : uint32_t { Hello, Reset, Step, Observe };
+
+enum class EnvStatus : uint32_t { Ok, BadRequest, BadEnv };
+
+struct EnvRequest {
+    EnvOp    op;
+    uint32_t count;
+    uint32_t frames;
+    uint32_t reserved;
+};
+
+// arg is the seed for Reset and the key mask (bit n being key n) for Step
+struct EnvSlot {
+    uint32_t env;
+    uint32_t arg;
+};
+
+// a Hello reply carries the number of environments in count and the shared
+// memory name (for shm_open) in name. other replies leave name empty
+struct EnvReply {
+    uint32_t  magic;
+    uint32_t  version;
+    EnvStatus status;
+    uint32_t  count;
+    char      name[ENVD_NAME];
+};
+
+struct Observation {
+    // frames run since the last reset
+    uint64_t frame;
+
+    // hash of the whole machine state, handy for novelty search
+    uint64_t stateHash;
+
+    // a word per row, with the msb as the leftmost pixel
+    std::array<std::array<uint64_t, ENVD_HEIGHT>, ENVD_PLANES> display;
+
+    // set once the rom faults. it stays set, and Step leaves the
+    // environment alone, until it is reset
+    uint8_t done;
+    uint8_t reserved[7];
+};
+
+// the shared memory is an EnvHeader followed by count Observations
+struct EnvHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef EXPLORE_H
+#define EXPLORE_H
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "chip8.hpp"
+
+// Explorer searches a rom for every reachable piece of code by treating it as
+// a black box (go-explore/afl style). each worker picks a saved state from the
+// corpus, restores it and plays a random mutation of input from there. any run
+// that reaches a pc never seen before is saved back into the corpus along with
+// the inputs that lead to it, and any run that faults is kept as a crash
+class Explorer {
+  public:
+    Explorer(std::string rom, int threads);
+
+    void run(double seconds);
+    void report(std::string crashDir);
+
+  private:
+    // a state worth exploring from and the per frame key masks, starting
+    // from reset, that reproduce it
+    struct Entry {
+        State                 state;
+        std::vector<uint16_t> inputs;
+    };
+
+    struct Crash {
+        std::string           fault;
+        uint16_t              pc;
+        std::vector<uint16_t> inputs;
+    };
+
+    std::string rom;
+    int         threads;
+
+    std::mutex         lock;
+    std::vector<Entry> corpus;
+    std::vector<Crash> crashes;
+    std::set<uint64_t> hashes;
+    std::set<std::pair<std::string, uint16_t>> crashSites;
+
+    std::array<std::atomic<bool>, MEM_SIZE> covered;
+
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> runs;
+
+    void work(int seed, double seconds);
+};
+
+#endif
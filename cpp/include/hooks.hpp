@@ -0,0 +1,114 @@
+#ifndef HOOKS_H
+#define HOOKS_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "chip8.hpp"
+
+// the machine as a hook sees it, just before the hooked instruction runs.
+// memory written through poke() is seen by the instruction and everything
+// after it, the same as a write by the rom itself
+class HookContext {
+  public:
+    HookContext(Chip8& chip8, uint16_t op);
+
+    uint16_t pc() const;
+    uint16_t op() const;
+
+    byte reg(byte r) const;
+    void setReg(byte r, byte value);
+
+    uint16_t index() const;
+    void     setIndex(uint16_t value);
+
+    byte peek(uint16_t addr) const;
+    void poke(uint16_t addr, byte value);
+
+    // everything else (keys, the display, saving state) goes through the
+    // machine's own interface
+    Chip8& machine();
+
+  private:
+    Chip8&   chip8;
+    uint16_t opcode;
+};
+
+using Hook = std::function<void(HookContext&)>;
+
+// callbacks on reaching an address or running an opcode, for bots and
+// instrumentation that would otherwise poll memory after every instruction.
+// whether an instruction has hooks at all is a lookup of one bit by address
+// and one by opcode, and the hooks themselves are only searched when one of
+// those is set. fused ops and compiled code still run wherever none of the
+// instructions they cover are hooked, so a hook on a compiled instruction
+// turns the compiled code off while it is set.
+//
+// hooks don't fire in run-ahead frames or while netplay runs frames again
+// after a rollback, so nothing is seen twice. a netplay frame run on a
+// predicted input has already fired its hooks though, and a rollback can
+// take back what they saw
+class Hooks {
+  public:
+    Hooks();
+
+    // returns an id for remove()
+    int onPc(uint16_t addr, Hook hook);
+
+    // every opcode where (op & mask) == match, so (0xF000, 0xD000) for
+    // every DXYN and (0xF0FF, 0xF033) for every FX33
+    int onOpcode(uint16_t mask, uint16_t match, Hook hook);
+
+    void remove(int id);
+
+    bool armed() const {
+        return !entries.empty();
+    }
+
+    bool hooked(uint16_t pc, uint16_t op) const {
+        return (pcs[pc >> 6] >> (pc & 63) & 1) ||
+               (byOpcode && (ops[op >> 6] >> (op & 63) & 1));
+    }
+
+    // the opcode is only fetched when there are opcode hooks to look it up
+    // for, so hooks on addresses alone cost one bit per instruction
+    void dispatch(Chip8& chip8, uint16_t pc) {
+        if ((pcs[pc >> 6] >> (pc & 63) & 1) || byOpcode) {
+            uint16_t op = (chip8.memory[pc] << 8) |
+                          chip8.memory[uint16_t(pc + 1)];
+            if (hooked(pc, op)) {
+                fire(chip8, pc, op);
+            }
+        }
+    }
+
+    // changes whenever a hook is added or removed
+    uint32_t version() const {
+        return changes;
+    }
+
+  private:
+    // a pc hook matches the address, an opcode hook the opcode
+    struct Entry {
+        int      id;
+        bool     byPc;
+        uint16_t mask;
+        uint16_t match;
+        Hook     hook;
+    };
+
+    // one bit per address and one per opcode value
+    std::array<uint64_t, MEM_SIZE / 64>  pcs;
+    std::array<uint64_t, (1 << 16) / 64> ops;
+    std::vector<Entry>                   entries;
+    int                                  nextId;
+    uint32_t                             changes;
+    bool                                 byOpcode;
+
+    void fire(Chip8& chip8, uint16_t pc, uint16_t op);
+    void mark(const Entry& entry);
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// shared memory between an emulator process (chip8 --serve name) and a front
+// end such as the qt app. the emulator publishes a snapshot of the machine
+// after every present and takes commands from a ring the front end fills.
+// neither side ever waits on the other: a snapshot is guarded by a seqlock so
+// readers just retry if they raced a write, and a full command ring drops the
+// command. a front end that hangs or crashes leaves the emulator running and
+// can simply attach again.
+//
+// this header is shared with the qt app so it doesn't depend on chip8.hpp
+
+#define IPC_MAGIC 0x43385348
+#define IPC_VERSION 3
+
+#define IPC_MEM_SIZE 0x10000
+#define IPC_WIDTH 64
+#define IPC_HEIGHT 32
+#define IPC_PLANES 2
+#define IPC_COMMANDS 256
+#define IPC_PATH 256
+
+// attempts at reading a consistent snapshot before giving up. an emulator
+// that died part way through a write leaves the sequence odd for good
+#define IPC_READ_TRIES 1000
+
+struct Snapshot {
+    // presents published so far. a front end can tell the emulator is gone
+    // when this stops moving
+    uint64_t frame;
+
+    // a bit per pixel, IPC_WIDTH / 8 bytes per row with the leftmost pixel
+    // in the msb of the first byte. that is QImage::Format_Mono, so a plane
+    // can be wrapped as an image as is. the display is only rewritten when
+    // its hash changes
+    uint64_t displayHash;
+    std::array<std::array<uint8_t, IPC_HEIGHT * IPC_WIDTH / 8>, IPC_PLANES>
+        display;
+
+    std::array<uint8_t, 16>  v;
+    std::array<uint16_t, 16> stack;
+    uint16_t                 pc;
+    uint16_t                 i;
+    uint8_t                  sp, dt, st;
+    bool                     running;
+    bool                     paused;
+
+    // metrics over the last second, see Metrics
+    double instructionsPerSecond;
+    double framesPerSecond;
+    double frameTimeP99;
+    double cpuShare;
+
+    // memory is only copied when its hash changes
+    uint64_t                          memoryHash;
+    std::array<uint8_t, IPC_MEM_SIZE> memory;
+};
+
+enum class CommandType : uint8_t {
+    Pause,
+    Resume,
+    Step,
+    KeyDown,
+    KeyUp,
+    Load,
+    Reset,
+    Quit
+};
+
+struct Command {
+    CommandType type;
+    uint8_t     key;
+    char        path[IPC_PATH];
+};
+
+struct SharedState {
+    uint32_t magic;
+    uint32_t version;
+
+    // odd while the emulator is writing the snapshot
+    alignas(64) std::atomic<uint32_t> sequence;
+    Snapshot snapshot;
+
+    // single producer (the front end), single consumer (the emulator)
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    std::array<Command, IPC_COMMANDS> commands;
+};
+
+class SharedMemory {
+  public:
+    SharedMemory();
+    ~SharedMemory();
+
+    // the emulator creates the segment and removes it on close, the front
+    // end attaches to an existing one
+    bool create(std::string name);
+    bool attach(std::string name);
+    void close();
+
+    bool isOpen() const;
+
+    // emulator side. the snapshot may only be written between these
+    Snapshot& beginPublish();
+    void      endPublish();
+    bool      receive(Command& command);
+
+    // front end side. use is called with the snapshot in place, without
+    // copying it, and called again if the emulator wrote to it meanwhile, so
+    // nothing it does should stick until read returns true
+    template <typename F> bool read(F&& use) const {
+        for (int t = 0; t < IPC_READ_TRIES; t++) {
+            uint32_t before = state->sequence.load(std::memory_order_acquire);
+            if (before & 0x1) {
+                continue;
+            }
+            use(state->snapshot);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (state->sequence.load(std::memory_order_relaxed) == before) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // false if the ring is full
+    bool send(const Command& command);
+
+  private:
+    SharedState* state;
+    std::string  name;
+    bool         owner;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// where the host loop's time goes
+//   Wait:    sleeping or blocked on the pacer
+//   Events:  reading input
+//   Cpu:     emulating, run ahead included
+//   Present: drawing and presenting (which blocks for vsync)
+enum class Phase : uint8_t { Wait, Events, Cpu, Present };
+
+#define PHASES 4
+
+// seconds each report covers
+#define METRICS_PERIOD 1.0
+
+// frame times kept for the overlay graph
+#define METRICS_GRAPH 64
+
+struct MetricsReport {
+    // seconds since metrics started, at the end of this report
+    double time;
+
+    double instructions;
+    double frames;
+    double presents;
+
+    // ms between presents
+    double p50, p95, p99, worst;
+
+    // fraction of the period spent in each phase
+    std::array<double, PHASES> share;
+
+    // ms emulated time is ahead of the host clock since the start. it only
+    // moves when frames are dropped or run to catch up
+    double drift;
+};
+
+// Metrics times the run loop. the loop marks the end of each phase and each
+// present, and once a period sample() rolls everything up into a report of
+// rates, frame time percentiles and where the time went. nothing allocates
+// once running
+class Metrics {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    Metrics();
+
+    // starts timing from now, dropping anything recorded so far
+    void start();
+
+    // charges the time since the last mark to phase
+    void mark(Phase phase);
+
+    void emulated(int frames, uint64_t instructions);
+    void presented();
+
+    // true once a period has passed, with report filled in
+    bool sample(MetricsReport& report);
+
+    // the latest report, zeroed until the first period is over
+    const MetricsReport& last() const;
+
+    // ms per present for the last METRICS_GRAPH presents, oldest first
+    std::array<float, METRICS_GRAPH> graph() const;
+
+    static void writeJson(std::ostream& out, const MetricsReport& report);
+
+  private:
+    clock::time_point begin;
+    clock::time_point window;
+    clock::time_point marked;
+    clock::time_point lastPresent;
+
+    std::array<double, PHASES> spent;
+
+    uint64_t instructions;
+    uint64_t frames;
+    uint64_t presents;
+    uint64_t totalFrames;
+
+    // ms between presents this period, reserved up front
+    std::vector<float> frameTimes;
+    std::vector<float> sorted;
+
+    std::array<float, METRICS_GRAPH> recent;
+    int                              recentAt;
+
+    MetricsReport latest;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include "chip8.hpp"
+
+// "C8NP"
+#define NETPLAY_MAGIC 0x504E3843
+#define NETPLAY_VERSION 1
+
+// frames of snapshots and inputs kept. this bounds how far back a rollback
+// can go and how much delay there can be
+#define NETPLAY_RING 64
+
+// frames the local side may run past the last remote input it has before it
+// waits for the peer
+#define NETPLAY_PREDICT 12
+
+// default frames between a key press and the frame it lands in. the more
+// delay, the less often a late remote input means a rollback
+#define NETPLAY_DELAY 2
+
+// most inputs a packet carries. every packet repeats all of the inputs the
+// peer hasn't acknowledged yet (up to this many), so a lost packet costs
+// nothing once the next one arrives
+#define NETPLAY_REDUNDANT 24
+
+// ms finish() waits for the peer, and keeps answering it once done
+#define NETPLAY_TIMEOUT 5000
+#define NETPLAY_LINGER 200
+
+// both ends are assumed to share a byte order
+struct NetplayPacket {
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  count;
+
+    // inputs[n] is the sender's input for frame first + n
+    uint32_t first;
+    uint16_t inputs[NETPLAY_REDUNDANT];
+
+    // frames of the receiver's input the sender has, all of them
+    uint32_t ack;
+
+    // the last frame the sender has both inputs for everything before, and
+    // the state hash at its start, to catch a desync
+    uint32_t checked;
+    uint64_t hash;
+};
+
+// rollback netplay for two machines running the same rom. each side's input
+// for a frame is the keys pressed on it, and a frame runs with both sides'
+// presses. local presses are delayed a few frames and sent to the peer right
+// away. a frame whose remote input hasn't arrived yet runs with the last one
+// that did, and the state at the start of every frame goes into a ring. when
+// a remote input turns up that differs from what was predicted, the machine
+// is restored to that frame and run forward again with what is now known.
+//
+// the debugger and tracing don't know about rollbacks, so neither should be
+// on while playing
+class Netplay {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    Netplay();
+    ~Netplay();
+
+    // listens on port and talks to peer, given as host:port
+    bool open(int port, std::string peer);
+    void close();
+
+    void setDelay(int frames);
+
+    // drops loss (0 to 1) of the packets sent and delays the rest by latency
+    // plus up to jitter ms, to try out bad connections over loopback
+    void simulate(int latency, int jitter, double loss);
+
+    // runs the next frame with pressed (plus anything pressed while stalled)
+    // as the local input. false if it is too far ahead of the peer, in which
+    // case nothing ran
+    bool advance(Chip8& chip8, uint16_t pressed);
+
+    // waits until the peer's input for every frame run is in, so the machine
+    // ends up in the same state on both sides. false if the peer went quiet
+    bool finish(Chip8& chip8);
+
+    void report(std::ostream& out) const;
+
+  private:
+    struct Delayed {
+        clock::time_point due;
+        NetplayPacket     packet;
+    };
+
+    int                 fd;
+    sockaddr_storage    peerAddr;
+    socklen_t           peerLen;
+    std::deque<Delayed> outbox;
+    std::minstd_rand    rng;
+
+    int    delay;
+    int    latency;
+    int    jitter;
+    double loss;
+
+    // the next frame to run, the first frame without remote input, the
+    // first frame without local input and the first frame of local input
+    // the peer doesn't have
+    uint32_t now;
+    uint32_t remoteNext;
+    uint32_t localNext;
+    uint32_t peerAck;
+
+    // the earliest frame that ran with a wrong prediction, if before now
+    uint32_t rollbackFrom;
+    uint16_t pending;
+
+    // indexed by frame % NETPLAY_RING. used is the remote input a frame
+    // actually ran with, known or predicted
+    std::vector<State>                 states;
+    std::array<uint16_t, NETPLAY_RING> local;
+    std::array<uint16_t, NETPLAY_RING> remote;
+    std::array<uint16_t, NETPLAY_RING> used;
+    std::array<uint64_t, NETPLAY_RING> hashes;
+    std::array<uint32_t, NETPLAY_RING> hashFrames;
+    uint32_t                           checked;
+    bool                               desynced;
+
+    uint64_t rollbacks;
+    uint64_t resimulated;
+    uint64_t stalls;
+    uint64_t dropped;
+    double   rollbackTotal;
+    double   rollbackWorst;
+
+    void simulateFrame(Chip8& chip8, uint32_t frame);
+    void rollback(Chip8& chip8);
+    void receive();
+    void send();
+    void flush();
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <chrono>
+
+#include "audio.hpp"
+
+// how the run loop decides when to present the next frame
+//   Sleep: sleep until the next 60hz deadline
+//   Vsync: let a vsynced present block and run however many emulated frames
+//          fit into the measured refresh period
+//   Audio: sleep while the audio device still has enough queued samples
+enum class Pacing { Sleep, Vsync, Audio };
+
+// Pacer keeps emulated time locked to one host clock and hands back the number
+// of emulated frames that should run before the next present. whichever clock
+// it follows, audio is kept in sync by nudging the audio resample ratio
+// towards a fixed buffer level (dynamic rate control)
+class Pacer {
+  public:
+    Pacer(Pacing mode, Audio& audio, int refresh);
+
+    int wait();
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    Pacing mode;
+    Audio& audio;
+
+    clock::time_point next;
+    clock::time_point last;
+
+    double period;
+    double pending;
+
+    void adjustAudio();
+};
+
+#endif
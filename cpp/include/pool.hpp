@@ -0,0 +1,44 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <string>
+#include <vector>
+
+#include "chip8.hpp"
+
+// a fixed number of instances of one rom, all made (and the rom loaded) up
+// front in a single block. acquire hands out an instance in the state the rom
+// starts in and release takes it back. neither touches the heap, so batch
+// runs can go through millions of episodes without ever calling malloc
+class Chip8Pool {
+  public:
+    Chip8Pool(std::string rom, int size);
+    ~Chip8Pool();
+
+    Chip8Pool(const Chip8Pool&)            = delete;
+    Chip8Pool& operator=(const Chip8Pool&) = delete;
+
+    bool isLoaded() const;
+    int  size() const;
+
+    // null once every instance is in use
+    Chip8* acquire();
+    void   release(Chip8* chip8);
+
+    // puts an instance back to the state the rom starts in, as acquire does
+    void reset(Chip8& chip8) const;
+
+    Chip8& operator[](int n);
+
+  private:
+    Chip8* instances;
+    int    count;
+    bool   loaded;
+
+    State initial;
+
+    // instances not handed out, reserved to the full size
+    std::vector<Chip8*> free;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef ROMCACHE_H
+#define ROMCACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "chip8.hpp"
+
+// "C8RC"
+#define ROM_CACHE_MAGIC 0x43523843
+
+// bump whenever anything stored would come out differently: the Fusion
+// values, the patterns decodeFusion looks for, the font or the memory hash
+#define ROM_CACHE_VERSION 2
+
+// entries are ~/.chip8/cache/<rom hash as 16 hex digits>.c8c, next to the
+// rom browser's .info files. the header is followed by the fusion decoded at
+// each of the rom's romSize addresses, one byte each. the file is only ever
+// read on the machine that wrote it, so it is in native byte order
+struct RomCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t romHash;
+    uint32_t romSize;
+    uint32_t reserved;
+
+    // the memory hash straight after loading, which otherwise means hashing
+    // all 64K of memory
+    uint64_t memoryHash;
+};
+
+// what load() works out from the rom alone, kept between runs. it is never
+// needed, so anything wrong with an entry (missing, stale, cut short) just
+// means working it out again, and nothing is printed either way
+class RomCache {
+  public:
+    RomCache();
+    ~RomCache();
+
+    // maps the entry for a rom. false unless it is there and was written by
+    // this version for a rom with the same hash and size
+    bool open(uint64_t romHash, uint32_t romSize);
+
+    const RomCacheHeader& header() const;
+    const Fusion*         fusion() const;
+
+    // writes a whole entry to a temporary file and renames it into place, so
+    // open() never sees half of one
+    static bool save(const RomCacheHeader& header, const Fusion* fusion);
+
+    // empty without a home directory
+    static std::string path(uint64_t romHash);
+
+  private:
+    const byte* data;
+    size_t      size;
+};
+
+#endif
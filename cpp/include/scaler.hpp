@@ -0,0 +1,78 @@
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#define SCALER_WIDTH 64
+#define SCALER_HEIGHT 32
+#define SCALER_PLANES 2
+
+// slack at the end of an expanded row. pixels are written with whole vector
+// stores that can run up to a vector past their end
+#define SCALER_SLACK 8
+
+enum class Upscale : uint8_t {
+    // every pixel becomes a scale x scale block
+    Nearest,
+    // EPX/Scale2x first doubles the display, rounding off diagonal edges,
+    // then that is scaled by scale / 2
+    Scale2x,
+    // nearest with every block's bottom row at half brightness
+    Scanlines
+};
+
+// software upscaling of the packed display straight into 32 bit pixels, for
+// when there is no renderer to scale on the gpu. each display row is expanded
+// once into a row of output pixels (with sse2 or avx2 stores where the cpu has
+// them) and that row is then copied down for the rest of its block, so the
+// cost is one streaming write of the output
+class Scaler {
+  public:
+    using Planes =
+        std::array<std::array<uint64_t, SCALER_HEIGHT>, SCALER_PLANES>;
+    using Colors = std::array<uint32_t, 1 << SCALER_PLANES>;
+
+    Scaler();
+
+    void setMode(Upscale mode);
+
+    // out is SCALER_WIDTH * scale by SCALER_HEIGHT * scale pixels with pitch
+    // bytes from one row to the next
+    void draw(const Planes& display,
+              const Colors& colors,
+              int           scale,
+              uint32_t*     out,
+              int           pitch);
+
+    // which kernel expand() picked for this cpu
+    const char* kernel() const;
+
+  private:
+    Upscale mode;
+
+    // palette index of every pixel being scaled, doubled up for Scale2x
+    std::array<std::array<uint8_t, SCALER_WIDTH * 2>, SCALER_HEIGHT * 2> index;
+
+    std::vector<uint32_t> row;
+    std::vector<uint32_t> dark;
+
+    // writes colors[src[x]] over [edges[x], edges[x + 1]) of out for every
+    // x < width. edges are increasing
+    using Expand = void (*)(const uint8_t* src,
+                            const int*     edges,
+                            int            width,
+                            const uint32_t* colors,
+                            uint32_t*      out);
+
+    Expand      expand;
+    const char* kernelName;
+
+    std::vector<int> edges;
+
+    void indexNearest(const Planes& display);
+    void indexScale2x(const Planes& display);
+};
+
+#endif
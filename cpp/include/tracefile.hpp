@@ -0,0 +1,145 @@
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// execution traces: one record for every instruction executed plus a marker
+// at the end of every frame.
+//
+// a trace starts with a header ("C8TR", a version byte, then pc, i and V0-VF
+// as they were when tracing started) followed by records. each record starts
+// with a varint of (zigzag(pc - expected pc) << 4) | flags, the expected pc
+// being the one straight after the previous instruction, so straight line
+// code costs a single byte. then, depending on the flags
+//   TRACE_FRAME   nothing else, the record only marks the end of a frame
+//   otherwise     the opcode, 2 bytes big endian
+//   TRACE_V       a varint mask of the registers written, then their values
+//   TRACE_MEM     a varint count of memory writes, then for each a zigzag
+//                 varint address (relative to i before the instruction for
+//                 the first write and to the previous write after that) and
+//                 the value
+//   TRACE_I       zigzag varint of the change to i
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+
+#define TRACE_V 0x1
+#define TRACE_I 0x2
+#define TRACE_MEM 0x4
+#define TRACE_FRAME 0x8
+
+// no instruction writes more than 16 bytes of memory (FX55, 5XY2)
+#define TRACE_MAX_WRITES 16
+
+// size of each of the writer's two buffers
+#define TRACE_BUFFER (1 << 20)
+
+typedef uint8_t byte;
+
+// registers and memory writes of a single instruction
+struct TraceRecord {
+    uint64_t index;
+    uint32_t frame;
+    uint16_t pc;
+    uint16_t op;
+    byte     flags;
+
+    // full register state after the instruction. vMask lists the ones it
+    // changed
+    std::array<byte, 16> v;
+    uint16_t             vMask;
+    uint16_t             i;
+
+    std::array<uint16_t, TRACE_MAX_WRITES> addr;
+    std::array<byte, TRACE_MAX_WRITES>     value;
+    int                                    writes;
+};
+
+// streams records to a file. records are encoded into one buffer while a
+// background thread writes out the other, so the emulator only ever pays for
+// the encoding
+class TraceWriter {
+  public:
+    TraceWriter();
+    ~TraceWriter();
+
+    bool open(std::string path);
+    void close();
+
+    void header(uint16_t pc, uint16_t i, const std::array<byte, 16>& v);
+
+    // an instruction is traced by begin() before it runs, write() for every
+    // byte of memory it stores and end() with the registers afterwards
+    void begin(uint16_t pc, uint16_t op);
+    void write(uint16_t addr, byte value);
+    void end(uint16_t i, const std::array<byte, 16>& v);
+
+    void frame();
+
+  private:
+    std::FILE*  file;
+    std::thread thread;
+
+    std::mutex              lock;
+    std::condition_variable ready;
+    bool                    pending;
+    bool                    stopping;
+
+    // front is filled by the emulator and back is written out by the thread
+    std::vector<byte> front;
+    std::vector<byte> back;
+    size_t            used;
+    size_t            backUsed;
+
+    uint16_t             pc;
+    uint16_t             op;
+    uint16_t             expected;
+    uint16_t             lastI;
+    std::array<byte, 16> lastV;
+
+    std::array<uint16_t, TRACE_MAX_WRITES> addr;
+    std::array<byte, TRACE_MAX_WRITES>     value;
+    int                                    writes;
+
+    void varint(uint32_t value);
+    void swap();
+    void flushLoop();
+};
+
+// reads a trace back through a memory map of the whole file
+class TraceReader {
+  public:
+    TraceReader();
+    ~TraceReader();
+
+    bool open(std::string path);
+
+    // decodes the next instruction into record, skipping frame markers.
+    // returns false at the end of the trace
+    bool next(TraceRecord& record);
+
+    // false if the trace ended part way through a record
+    bool complete() const;
+
+  private:
+    const byte* data;
+    size_t      size;
+    size_t      pos;
+    bool        truncated;
+
+    uint64_t             index;
+    uint32_t             frame;
+    uint16_t             expected;
+    uint16_t             i;
+    std::array<byte, 16> v;
+
+    bool varint(uint32_t& value);
+};
+
+#endif
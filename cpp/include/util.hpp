@@ -1,7 +1,10 @@
 #include <array>
-#include <map>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <string>
+#include <vector>
 
 template <typename T, size_t size>
 void printArr(std::array<T, size> arr, int width = 80) {
@@ -17,9 +20,39 @@ template <typename T1, typename T2> void printArr(std::map<T1, T2> m) {
         std::cout << key << " : " << value << std::endl;
     }
 }
-int fileLength(std::ifstream& file) {
+inline int fileLength(std::ifstream& file) {
     file.seekg(0, file.end);
     int len = file.tellg();
     file.seekg(0, file.beg);
     return len;
 }
+
+// 64 bit FNV-1a. used to identify roms. hash continues a previous result
+inline uint64_t fnv1a(const uint8_t* data,
+                      size_t         len,
+                      uint64_t       hash = 0xcbf29ce484222325) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+// per frame key masks, one hex number per line. anything else (such as the
+// fault on the first line of an explorer crash file) is skipped
+inline std::vector<uint16_t> readInputs(std::string path) {
+    std::vector<uint16_t> inputs;
+    std::ifstream         file{ path };
+    std::string           line;
+    while (std::getline(file, line)) {
+        size_t end{ 0 };
+        try {
+            auto mask = std::stoul(line, &end, 16);
+            if (end == line.size()) {
+                inputs.push_back(mask);
+            }
+        } catch (const std::exception&) {
+        }
+    }
+    return inputs;
+}
@@ -0,0 +1,121 @@
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define VIDEO_WIDTH 64
+#define VIDEO_HEIGHT 32
+#define VIDEO_PLANES 2
+#define VIDEO_RATE 60
+
+// frames the emulator can get ahead of the encoder before push() blocks
+#define VIDEO_QUEUE 64
+
+// the 1-bit run length container: "C8RL", a version byte, then width,
+// height and planes as single bytes, followed by a record for every kept
+// frame that differs from the one before it. a record is a varint of the
+// frames since the previous record (the first counts from frame 0), then for
+// each plane the lengths of alternating runs of unset and set pixels, as
+// varints, covering the plane row by row from the top left. the first run
+// can be 0 long
+#define VIDEO_RLE_MAGIC "C8RL"
+#define VIDEO_RLE_VERSION 1
+
+enum class VideoFormat : uint8_t {
+    // raw 4:4:4 yuv at the display scale, every kept frame
+    Y4m,
+    // 4 color gif at the display scale. repeated frames only stretch the
+    // delay of the one before, and changed frames only store the rectangle
+    // that changed
+    Gif,
+    // the container above, at 1 pixel per pixel
+    Rle
+};
+
+// records the display to a file. push() copies the display into a bounded
+// queue and a background thread does all of the encoding and writing, so
+// the emulator only ever waits when the encoder falls VIDEO_QUEUE frames
+// behind
+class VideoWriter {
+  public:
+    using Planes = std::array<std::array<uint64_t, VIDEO_HEIGHT>, VIDEO_PLANES>;
+    using Colors = std::array<std::array<uint8_t, 3>, 1 << VIDEO_PLANES>;
+
+    VideoWriter();
+    ~VideoWriter();
+
+    // the format comes from the extension (.y4m, .gif or .rle). only every
+    // every'th frame is kept
+    bool open(std::string path, int scale, int every);
+
+    // waits for the encoder to catch up and finishes the file
+    void close();
+
+    // must be set before the first push
+    void setPalette(const Colors& colors);
+
+    // frame is the emulated frame number, which sets the frame's time
+    void push(uint32_t frame, const Planes& display);
+
+  private:
+    struct Frame {
+        uint32_t number;
+        Planes   display;
+    };
+
+    std::FILE*  file;
+    std::thread thread;
+    VideoFormat format;
+    int         scale;
+    int         every;
+    Colors      palette;
+
+    std::mutex                     lock;
+    std::condition_variable        ready;
+    std::condition_variable        space;
+    std::array<Frame, VIDEO_QUEUE> queue;
+    size_t                         head;
+    size_t                         count;
+    bool                           stopping;
+
+    // everything below belongs to the encoder thread
+
+    // bytes of the current frame, written out in one go
+    std::vector<uint8_t> out;
+
+    bool     started;
+    Planes   last;
+    uint32_t lastNumber;
+
+    // the gif frame waiting to find out how long it is shown for
+    bool                 held;
+    uint32_t             heldNumber;
+    std::array<int, 4>   heldRect;
+    std::vector<uint8_t> heldData;
+
+    // lzw dictionary, the code for every (code, pixel) pair
+    std::vector<uint16_t> lzwTable;
+
+    void encodeLoop();
+    void encode(const Frame& frame);
+    void finish();
+
+    void y4mFrame(const Planes& display);
+    void gifHeader();
+    void gifFrame(const Frame& frame);
+    void gifFlush(uint32_t until);
+    void lzw(const std::vector<uint8_t>& pixels);
+    void rleFrame(const Frame& frame);
+
+    void varint(uint32_t value);
+    void flush();
+};
+
+#endif
@@ -0,0 +1,359 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "chip8.hpp"
+#include "util.hpp"
+
+// chip8-aot: translates a rom into a C++ file that links against the core.
+//
+// control flow is discovered from 0x200 and every basic block becomes one case
+// of a switch on pc. simple instructions are translated inline, anything with
+// more involved semantics (sprites aside) goes through Chip8::tick() so the
+// interpreter stays the single source of truth. computed jumps (BNNN) and
+// returns simply set pc and go back through the switch, and any address that
+// wasn't discovered falls back to the interpreter
+//
+// usage: chip8-aot rom [out.cpp]
+
+struct Block {
+    uint16_t    start;
+    uint16_t    end;
+    int         count;
+    std::string code;
+};
+
+std::vector<byte> rom;
+
+bool inRom(int addr, int len = 2) {
+    return addr >= PROGRAM_MEM_START &&
+           addr + len <= PROGRAM_MEM_START + static_cast<int>(rom.size());
+}
+
+uint16_t opAt(int addr) {
+    int o = addr - PROGRAM_MEM_START;
+    return (rom[o] << 8) | rom[o + 1];
+}
+
+// F000 NNNN is the only 4 byte instruction
+int length(uint16_t op) {
+    return op == 0xF000 ? 4 : 2;
+}
+
+bool isSkip(uint16_t op) {
+    switch (op >> 12) {
+        case 0x3:
+        case 0x4:
+        case 0x9:
+            return true;
+        case 0x5:
+            return (op & 0xF) == 0;
+        case 0xE:
+            return (op & 0xFF) == 0x9E || (op & 0xFF) == 0xA1;
+    }
+    return false;
+}
+
+// instructions that end a block: anything that moves pc somewhere other than
+// the next instruction (including FX0A, which repeats until a key is down),
+// and anything that writes memory (which could turn the compiled code off)
+bool ends(uint16_t op) {
+    switch (op >> 12) {
+        case 0x1:
+        case 0x2:
+        case 0xB:
+            return true;
+        case 0x0:
+            return op == 0x00EE || op == 0x00FD;
+        case 0x5:
+            return isSkip(op) || (op & 0xF) == 0x2;
+        case 0xF:
+            return (op & 0xFF) == 0x0A || (op & 0xFF) == 0x33 ||
+                   (op & 0xFF) == 0x55;
+    }
+    return isSkip(op);
+}
+
+int skipTarget(int addr) {
+    int next = addr + 2;
+    return next + (inRom(next) ? length(opAt(next)) : 2);
+}
+
+// indentation of a statement inside a case of the generated switch
+const std::string indent(20, ' ');
+
+std::string hex(int v) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "0x%X", v);
+    return buf;
+}
+
+// leaves pc pointing at addr and lets the interpreter run it
+std::string interpret(int addr) {
+    return indent + "c.pc = " + hex(addr) + ";\n" + indent + "c.tick();\n";
+}
+
+// stops is set for instructions that can trap in a checked build, which
+// leave the machine stopped partway through the block
+std::string translate(int addr, uint16_t op, bool& stops) {
+    std::string x  = hex((op >> 8) & 0xF);
+    std::string y  = hex((op >> 4) & 0xF);
+    std::string kk = hex(op & 0xFF);
+    std::string vx = "c.v[" + x + "]";
+    std::string vy = "c.v[" + y + "]";
+
+    auto line = [](std::string s) { return indent + s + "\n"; };
+    stops     = false;
+    auto skipIf = [&](std::string cond) {
+        return line("c.pc = " + cond + " ? " + hex(skipTarget(addr)) + " : " +
+                    hex(addr + 2) + ";");
+    };
+
+    switch (op >> 12) {
+        case 0x1:
+            return line("c.pc = " + hex(op & 0xFFF) + ";");
+        case 0x3:
+            return skipIf(vx + " == " + kk);
+        case 0x4:
+            return skipIf(vx + " != " + kk);
+        case 0x5:
+            if ((op & 0xF) == 0) {
+                return skipIf(vx + " == " + vy);
+            }
+            break;
+        case 0x6:
+            return line(vx + " = " + kk + ";");
+        case 0x7:
+            return line(vx + " += " + kk + ";");
+        case 0x8:
+            switch (op & 0xF) {
+                case 0x0:
+                    return line(vx + " = " + vy + ";");
+                case 0x1:
+                    return line(vx + " |= " + vy + ";");
+                case 0x2:
+                    return line(vx + " &= " + vy + ";");
+                case 0x3:
+                    return line(vx + " ^= " + vy + ";");
+                case 0x4:
+                    return line("{") +
+                           line("    uint16_t tmp = " + vx + " + " + vy +
+                                ";") +
+                           line("    c.v[0xF]     = tmp > 255;") +
+                           line("    " + vx + " = tmp;") + line("}");
+                case 0x5:
+                    return line("c.v[0xF] = " + vx + " > " + vy + ";") +
+                           line(vx + " -= " + vy + ";");
+                case 0x6:
+                    return line("c.v[0xF] = " + vx + " & 0x1;") +
+                           line(vx + " >>= 1;");
+                case 0x7:
+                    return line("c.v[0xF] = " + vy + " > " + vx + ";") +
+                           line(vx + " = " + vy + " - " + vx + ";");
+                case 0xE:
+                    return line("c.v[0xF] = " + vx + " >> 7;") +
+                           line(vx + " <<= 1;");
+            }
+            break;
+        case 0x9:
+            return skipIf(vx + " != " + vy);
+        case 0xA:
+            return line("c.i = " + hex(op & 0xFFF) + ";");
+        case 0xB:
+            return line("c.pc = " + hex(op & 0xFFF) + " + c.v[0];");
+        case 0xD:
+            // pc as the interpreter would have it, for the fault report
+            stops = true;
+            return line("c.pc = " + hex(addr + 2) + ";") +
+                   line("c.sprite(" + x + ", " + y + ", " + hex(op & 0xF) +
+                        ");");
+        case 0xF:
+            switch (op & 0xFF) {
+                case 0x00:
+                    if (inRom(addr + 2)) {
+                        return line("c.i = " + hex(opAt(addr + 2)) + ";");
+                    }
+                    break;
+                case 0x07:
+                    return line(vx + " = c.dt;");
+                case 0x15:
+                    return line("c.dt = " + vx + ";");
+                case 0x18:
+                    return line("c.st = " + vx + ";");
+                case 0x1E:
+                    return line("c.i += " + vx + ";");
+                case 0x29:
+                    return line("c.i = " + vx + " * 5;");
+            }
+            break;
+    }
+
+    // everything else, including calls and returns (which check the stack)
+    // and skips on keys, keeps the interpreter's semantics. tick() leaves pc
+    // wherever the instruction sends it
+    stops = true;
+    return interpret(addr);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "usage: chip8-aot rom [out.cpp]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream romFile{ argv[1], std::ifstream::binary };
+    if (!romFile) {
+        std::cout << "Failed to open rom: " << argv[1] << std::endl;
+        return 1;
+    }
+    rom.resize(fileLength(romFile));
+    romFile.read(reinterpret_cast<char*>(rom.data()), rom.size());
+
+    // walk every reachable instruction, marking the addresses that start a
+    // block along the way
+    std::set<int>      leaders{ PROGRAM_MEM_START };
+    std::map<int, int> code;
+    std::vector<int>   work{ PROGRAM_MEM_START };
+
+    auto reach = [&](int addr) {
+        leaders.insert(addr);
+        work.push_back(addr);
+    };
+
+    while (!work.empty()) {
+        int addr = work.back();
+        work.pop_back();
+
+        while (inRom(addr) && !code.contains(addr)) {
+            uint16_t op  = opAt(addr);
+            int      len = length(op);
+            if (!inRom(addr, len)) {
+                break;
+            }
+            code[addr] = op;
+
+            if (isSkip(op)) {
+                reach(addr + 2);
+                reach(skipTarget(addr));
+                break;
+            }
+            if (op >> 12 == 0x1) {
+                reach(op & 0xFFF);
+                break;
+            }
+            if (op >> 12 == 0x2) {
+                reach(op & 0xFFF);
+                reach(addr + 2);
+                break;
+            }
+            if (ends(op)) {
+                // returns, computed jumps, exits, key waits and memory
+                // writes. the last two carry on at the next instruction
+                if (op >> 12 == 0x5 || op >> 12 == 0xF) {
+                    reach(addr + len);
+                }
+                break;
+            }
+            addr += len;
+        }
+
+        // ran into code walked before, which now has two ways in
+        if (code.contains(addr)) {
+            leaders.insert(addr);
+        }
+    }
+
+    // cut the discovered code into blocks
+    std::vector<Block> blocks;
+    for (int leader : leaders) {
+        if (!code.contains(leader)) {
+            continue;
+        }
+
+        Block block{ uint16_t(leader), uint16_t(leader), 0, "" };
+        int   addr = leader;
+        while (code.contains(addr)) {
+            uint16_t op = code[addr];
+            bool     stops;
+            block.code += translate(addr, op, stops);
+            block.count++;
+            addr += length(op);
+
+            if (ends(op)) {
+                // memory writes went through the interpreter, which already
+                // moved pc on. the switch checks running before going on
+                break;
+            }
+            if (stops) {
+                block.code += indent + "if (!c.running) {\n" + indent +
+                              "    return done + " +
+                              std::to_string(block.count) + ";\n" + indent +
+                              "}\n";
+            }
+            if (leaders.contains(addr) || !code.contains(addr)) {
+                block.code += indent + "c.pc = " + hex(addr) + ";\n";
+                break;
+            }
+        }
+        block.end = addr;
+        blocks.push_back(block);
+    }
+
+    std::FILE* out = argc > 2 ? std::fopen(argv[2], "w") : stdout;
+    if (!out) {
+        std::cout << "Failed to open output: " << argv[2] << std::endl;
+        return 1;
+    }
+
+    std::fprintf(out, "// generated by chip8-aot from %s\n", argv[1]);
+    std::fprintf(out, "#include \"chip8.hpp\"\n\n");
+    auto hash = static_cast<unsigned long long>(fnv1a(rom.data(), rom.size()));
+
+    std::fprintf(out, "template <> struct Aot<0x%llXull> {\n", hash);
+    std::fprintf(out, "    static int run(Chip8& c, int budget) {\n");
+    std::fprintf(out, "        int done{ 0 };\n");
+    std::fprintf(out, "        while (c.compiled && c.running) {\n");
+    std::fprintf(out, "            switch (c.pc) {\n");
+    for (auto& block : blocks) {
+        std::fprintf(out, "                case %s:\n", hex(block.start).c_str());
+        std::fprintf(out,
+                     "                    if (budget - done < %d) {\n"
+                     "                        return done;\n"
+                     "                    }\n",
+                     block.count);
+        std::fprintf(out, "%s", block.code.c_str());
+        std::fprintf(out, "                    done += %d;\n", block.count);
+        std::fprintf(out, "                    continue;\n");
+    }
+    std::fprintf(out, "                default:\n");
+    std::fprintf(out, "                    return done;\n");
+    std::fprintf(out, "            }\n");
+    std::fprintf(out, "        }\n");
+    std::fprintf(out, "        return done;\n");
+    std::fprintf(out, "    }\n");
+    std::fprintf(out, "};\n\n");
+
+    std::fprintf(out, "static const uint16_t ranges[] = {\n");
+    for (auto& block : blocks) {
+        std::fprintf(out,
+                     "    %s, %s,\n",
+                     hex(block.start).c_str(),
+                     hex(block.end).c_str());
+    }
+    std::fprintf(out, "};\n\n");
+
+    std::fprintf(out,
+                 "static bool registered = Chip8::registerCompiled(\n"
+                 "    { 0x%llXull, &Aot<0x%llXull>::run, ranges, %zu });\n",
+                 hash,
+                 hash,
+                 blocks.size());
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+}
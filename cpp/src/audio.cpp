@@ -0,0 +1,162 @@
+#include <cmath>
+#include <iostream>
+
+#include "audio.hpp"
+
+// frequency of the plain buzzer
+#define TONE 440.0
+
+Audio::Audio()
+    : device{ 0 }, wavSamples{ 0 }, phase{ 0 }, ratio{ 1 }, frac{ 0 } {}
+
+Audio::~Audio() {
+    close();
+}
+
+bool Audio::open() {
+    SDL_AudioSpec want{};
+    SDL_AudioSpec have{};
+
+    want.freq     = AUDIO_RATE;
+    want.format   = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples  = 512;
+    want.callback = callback;
+    want.userdata = this;
+
+    device = SDL_OpenAudioDevice(nullptr, 0, &want, &have, 0);
+    if (device == 0) {
+        std::cout << "Failed to open audio device" << std::endl;
+        return false;
+    }
+
+    SDL_PauseAudioDevice(device, 0);
+    return true;
+}
+
+// wav files are written as 16 bit mono pcm. the sizes in the header are not
+// known until we are done so they get patched in finishWav()
+bool Audio::record(std::string path) {
+    wav.open(path, std::ios::binary | std::ios::trunc);
+    if (!wav) {
+        std::cout << "Failed to open wav file: " << path << std::endl;
+        return false;
+    }
+
+    auto put32 = [&](uint32_t v) { wav.write(reinterpret_cast<char*>(&v), 4); };
+    auto put16 = [&](uint16_t v) { wav.write(reinterpret_cast<char*>(&v), 2); };
+
+    wav.write("RIFF", 4);
+    put32(0);
+    wav.write("WAVEfmt ", 8);
+    put32(16);
+    put16(1);
+    put16(1);
+    put32(AUDIO_RATE);
+    put32(AUDIO_RATE * 2);
+    put16(2);
+    put16(16);
+    wav.write("data", 4);
+    put32(0);
+
+    wavSamples = 0;
+    return true;
+}
+
+void Audio::finishWav() {
+    uint32_t data = wavSamples * 2;
+    uint32_t riff = data + 36;
+
+    wav.seekp(4);
+    wav.write(reinterpret_cast<char*>(&riff), 4);
+    wav.seekp(40);
+    wav.write(reinterpret_cast<char*>(&data), 4);
+    wav.close();
+}
+
+void Audio::close() {
+    if (device != 0) {
+        SDL_CloseAudioDevice(device);
+        device = 0;
+    }
+    if (wav.is_open()) {
+        finishWav();
+    }
+}
+
+bool Audio::playing() const {
+    return device != 0;
+}
+
+size_t Audio::queued() const {
+    return ring.count();
+}
+
+void Audio::setRatio(double r) {
+    ratio = r;
+}
+
+void Audio::generate(int                           count,
+                     bool                          on,
+                     const std::array<uint8_t, 16>& pattern,
+                     bool                          usePattern,
+                     uint8_t                       pitch) {
+    // nowhere for the samples to go, as when running headless
+    if (device == 0 && !wav.is_open()) {
+        return;
+    }
+
+    // XO-CHIP plays the 128 bit pattern at 4000*2^((pitch-64)/48) bits/sec
+    double step = usePattern
+                      ? 4000.0 * std::pow(2.0, (pitch - 64) / 48.0) / AUDIO_RATE
+                      : TONE / AUDIO_RATE;
+
+    samples.resize(count);
+
+    for (auto& sample : samples) {
+        sample = 0;
+
+        if (on) {
+            bool high;
+            if (usePattern) {
+                int bit = static_cast<int>(phase) & 127;
+                high    = (pattern[bit >> 3] >> (7 - (bit & 7))) & 0x1;
+                phase   = std::fmod(phase + step, 128.0);
+            } else {
+                high  = phase < 0.5;
+                phase = std::fmod(phase + step, 1.0);
+            }
+            sample = high ? AUDIO_VOLUME : -AUDIO_VOLUME;
+        }
+    }
+
+    if (wav.is_open()) {
+        wav.write(reinterpret_cast<char*>(samples.data()), count * 2);
+        wavSamples += count;
+    }
+
+    // the device gets the same samples stretched by ratio (nearest neighbor
+    // is plenty for a buzzer). a full ring means the device has fallen
+    // behind, drop the sample rather than ever waiting on the audio thread
+    if (device != 0) {
+        frac += count * ratio;
+        int out = static_cast<int>(frac);
+        frac -= out;
+        for (int s = 0; s < out; s++) {
+            ring.push(samples[s * count / out]);
+        }
+    }
+}
+
+void Audio::callback(void* userdata, Uint8* stream, int len) {
+    auto  audio   = static_cast<Audio*>(userdata);
+    auto  samples = reinterpret_cast<int16_t*>(stream);
+    int   count   = len / 2;
+
+    for (int s = 0; s < count; s++) {
+        // play silence on underrun
+        if (!audio->ring.pop(samples[s])) {
+            samples[s] = 0;
+        }
+    }
+}
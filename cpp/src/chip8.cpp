@@ -1,14 +1,30 @@
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 #include <SDL2/SDL.h>
 
 #include "chip8.hpp"
+#include "debugger.hpp"
+#include "hooks.hpp"
+#include "netplay.hpp"
+#include "romcache.hpp"
 #include "util.hpp"
 
+// searched in order for a rom, ~ being $HOME. nothing is built until a rom
+// is actually loaded
+const char* romDirs[]{ "", "./roms/", "~/.chip8/roms/" };
+
 std::array<byte, 80> hexChars{
     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
     0x20, 0x60, 0x20, 0x20, 0x70, // 1
@@ -37,134 +53,1192 @@ std::map<SDL_Scancode, byte> keymap{
     { SDL_SCANCODE_V, 0xF }
 };
 
-std::default_random_engine         gen;
-std::uniform_int_distribution<int> dist(0, 255);
+// color for each combination of plane bits. index 1 is the classic
+// single plane color
+std::array<std::array<byte, 3>, 1 << PLANES> palette{ {
+    { 0, 0, 0 },
+    { 0, 255, 255 },
+    { 255, 0, 255 },
+    { 255, 255, 255 },
+} };
+
+// splitmix64 finalizer
+uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+// zobrist key for a value at a location. rather than a table of random keys
+// per location and value (far too big for 64K of memory) the key is derived by
+// mixing both together. locations are numbered memory first, then display
+// rows, then everything else
+#define LOC_DISPLAY MEM_SIZE
+#define LOC_REGS (LOC_DISPLAY + PLANES * D_HEIGHT)
+
+uint64_t zobrist(uint32_t loc, uint64_t value) {
+    return mix(mix(value) ^ (loc * 0x9e3779b97f4a7c15));
+}
+
+Chip8::Chip8(std::string rom, int scale, bool cached, Safety safety)
+    : rom{ rom }, scale{ scale }, cycles{ CYCLES_PER_FRAME },
+      romSize{ 0 }, romHash{ 0 }, frameDelay{ 0 }, runAhead{ 0 },
+      muted{ false }, checked{ safety == Safety::Checked },
+      speculative{ false }, cached{ cached },
+      keyWait{ false },
+      pacing{ Pacing::Vsync }, renderer{ nullptr }, texture{ nullptr },
+      compiled{ nullptr }, romCompiled{ nullptr }, codeHash{ 0 },
+      coverage{ nullptr }, trace{ nullptr },
+      video{ nullptr }, netplay{ nullptr }, debugger{ nullptr },
+      hooks{ nullptr }, hooksSeen{ 0 }, hooksCompiled{ nullptr },
+      compiledHooked{ false }, frameCycle{ 0 }, retired{ 0 },
+      metricsLog{ nullptr }, overlay{ false }, faultReason{ nullptr },
+      memory{}, display{}, presented{},
+      inputPending{ false }, pressed{ 0 },
+      latencyCount{ 0 }, latencyTotal{ 0 }, latencyWorst{ 0 } {
+    init();
+    loaded = { load() };
+    if (!loaded) {
+        std::cout << "Failed to load rom: " << rom << std::endl;
+    }
+}
+
+// a fresh machine: empty memory with the font at the start
+void Chip8::init() {
+    memory.fill(0);
+    for (int i = 0; i < hexChars.size(); i++) {
+        memory[i] = hexChars[i];
+    }
+
+    reset();
+}
+
+void Chip8::reset() {
+    v.fill(0);
+    stack.fill(0);
+    pc = 0x200;
+    i  = 0;
+    sp = 0;
+    dt = 0;
+    st = 0;
+
+    faultReason = nullptr;
+    frameCycle  = 0;
+    fusion.fill(Fusion::Unknown);
+
+    plane         = 0x1;
+    pitch         = 64;
+    patternLoaded = false;
+    pattern       = {};
+
+    for (auto& p : display) {
+        p.fill(0);
+    }
+    rehash();
+
+    keys = 0;
+}
+
+bool Chip8::load() {
+    for (std::string dir : romDirs) {
+        if (dir[0] == '~') {
+            const char* home = std::getenv("HOME");
+            if (!home) {
+                continue;
+            }
+            dir = home + dir.substr(1);
+        }
+        std::ifstream romFile{ dir + rom, std::ifstream::in };
+        if (romFile) {
+            int size = fileLength(romFile);
+            int room = MEM_SIZE - PROGRAM_MEM_START;
+            if (size > room) {
+                if (checked) {
+                    std::cout << "Rom too large: " << dir + rom << " ("
+                              << size << " bytes, " << room << " fit)"
+                              << std::endl;
+                    return false;
+                }
+                size = room;
+            }
+            romFile.read(reinterpret_cast<char*>(memory.data()) +
+                             PROGRAM_MEM_START,
+                         size);
+            fusion.fill(Fusion::Unknown);
+            romSize = romFile.gcount();
+            romHash = fnv1a(memory.data() + PROGRAM_MEM_START, romSize);
+            attachCompiled(romSize);
+            analyse();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Chip8::isLoaded() const {
+    return loaded;
+}
+
+void Chip8::run() {
+    if (loaded == false) {
+        std::cout << "No rom loaded. Please load rom and try again"
+                  << std::endl;
+        return;
+    }
+    running = true;
+
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_AUDIO);
+    audio.open();
+    window = SDL_CreateWindow("Chip8",
+                              SDL_WINDOWPOS_UNDEFINED,
+                              SDL_WINDOWPOS_UNDEFINED,
+                              64 * scale,
+                              32 * scale,
+                              SDL_WINDOW_SHOWN);
+
+    // vsync needs a renderer to block on. the gpu does the scaling so the
+    // texture is just the native display size
+    if (pacing == Pacing::Vsync) {
+        renderer = SDL_CreateRenderer(
+            window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+        if (renderer) {
+            texture = SDL_CreateTexture(renderer,
+                                        SDL_PIXELFORMAT_ARGB8888,
+                                        SDL_TEXTUREACCESS_STREAMING,
+                                        D_WIDTH,
+                                        D_HEIGHT);
+        } else {
+            pacing = Pacing::Sleep;
+        }
+    }
+    if (!renderer) {
+        surface = SDL_GetWindowSurface(window);
+    }
+
+    SDL_DisplayMode mode{};
+    SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode);
+
+    Pacer pacer{ pacing, audio, mode.refresh_rate };
+    metrics.start();
+    uint32_t recorded{ 0 };
+
+    // input is read right before the frames it affects run, so it is never
+    // more than one present old. a frame delay pushes that read even later
+    // into the refresh, leaving just enough time to emulate and present
+    while (running) {
+        int frames = pacer.wait();
+        if (frameDelay > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(frameDelay));
+        }
+        metrics.mark(Phase::Wait);
+        handleEvents();
+        metrics.mark(Phase::Events);
+
+        // with netplay presses go to the session, which may hold frames back
+        // until the peer catches up
+        if (!netplay) {
+            keys |= pressed;
+            pressed = 0;
+        }
+        uint64_t before = retired;
+        int      ran    = 0;
+        for (; ran < frames && running; ran++) {
+            if (netplay) {
+                // stalled waiting for the peer, so no frame ran. the presses
+                // are held by the session until one does
+                bool advanced = netplay->advance(*this, pressed);
+                pressed       = 0;
+                if (!advanced) {
+                    break;
+                }
+            } else {
+                frame();
+            }
+            if (video) {
+                video->push(recorded++, display);
+            }
+        }
+        metrics.emulated(ran, retired - before);
+
+        // run ahead: show where the game will be runAhead frames from now
+        // with the current input, then rewind. this hides input lag that is
+        // built into the game itself
+        if (runAhead > 0 && !debugger && !netplay) {
+            // the speculative frames are kept out of any trace and hooks, and
+            // a fault in one of them is rewound along with everything else,
+            // since the real machine may never get there
+            State        now    = save();
+            TraceWriter* traced = trace;
+            bool         was    = running;
+            const char*  reason = faultReason;
+            uint16_t     at     = faultPc;
+            uint16_t     op     = faultOp;
+            muted               = true;
+            speculative         = true;
+            trace               = nullptr;
+            for (int f = 0; f < runAhead && running; f++) {
+                frame();
+            }
+            metrics.mark(Phase::Cpu);
+            draw();
+            trackLatency();
+            metrics.mark(Phase::Present);
+            restore(now);
+            muted       = false;
+            speculative = false;
+            trace       = traced;
+            running     = was;
+            faultReason = reason;
+            faultPc     = at;
+            faultOp     = op;
+            metrics.mark(Phase::Cpu);
+        } else {
+            metrics.mark(Phase::Cpu);
+            draw();
+            trackLatency();
+            metrics.mark(Phase::Present);
+        }
+        metrics.presented();
+        sampleMetrics();
+    }
+    reportFault();
+    if (netplay) {
+        netplay->report(std::cout);
+    }
+    if (latencyCount > 0) {
+        std::cout << "input latency: avg " << latencyTotal / latencyCount
+                  << "ms, worst " << latencyWorst << "ms over "
+                  << latencyCount << " presses" << std::endl;
+    }
+    if (renderer) {
+        SDL_DestroyRenderer(renderer);
+    }
+    audio.close();
+    SDL_Quit();
+}
+
+// runs the given number of 60hz frames as fast as possible with no window.
+// timers (and therefore audio) advance purely in emulated time
+void Chip8::runHeadless(int frames, const std::vector<uint16_t>& inputs) {
+    if (loaded == false) {
+        std::cout << "No rom loaded. Please load rom and try again"
+                  << std::endl;
+        return;
+    }
+    if (netplay) {
+        runNetplay(frames, inputs);
+        return;
+    }
+    Execution execution = execute();
+    int       keyed     = -1;
+    for (int f = 0; f < frames;) {
+        // once per frame, so FX0A taking a key isn't undone
+        if (!inputs.empty() && keyed != f) {
+            setKeys(f < inputs.size() ? inputs[f] : 0);
+            keyed = f;
+        }
+        if (!execution.resume()) {
+            break;
+        }
+        switch (execution.event()) {
+            case Yield::Frame:
+                if (video) {
+                    video->push(f, display);
+                }
+                f++;
+                break;
+            case Yield::Break:
+                // nobody is there to continue, so breakpoints just log
+                debugger->resume();
+                break;
+            case Yield::KeyWait:
+                // input never changes without a host, so just carry on
+                break;
+        }
+    }
+    reportFault();
+    audio.close();
+}
+
+// both sides have to run the same frames, so this waits for the peer to
+// confirm every one before stopping
+void Chip8::runNetplay(int frames, const std::vector<uint16_t>& inputs) {
+    running = true;
+    for (int f = 0; f < frames && running;) {
+        if (!netplay->advance(*this, f < inputs.size() ? inputs[f] : 0)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (video) {
+            video->push(f, display);
+        }
+        f++;
+    }
+    netplay->finish(*this);
+    reportFault();
+    netplay->report(std::cout);
+    audio.close();
+}
+
+// instructions only later platforms have, to tell which one a rom targets
+bool schipOp(uint16_t op) {
+    switch (op >> 12) {
+        case 0x0:
+            return (op & 0xFFF0) == 0x00C0 || (op >= 0x00FB && op <= 0x00FF);
+        case 0xD:
+            return (op & 0xF) == 0;
+        case 0xF:
+            return (op & 0xFF) == 0x30 || (op & 0xFF) == 0x75 ||
+                   (op & 0xFF) == 0x85;
+    }
+    return false;
+}
+
+bool xoChipOp(uint16_t op) {
+    switch (op >> 12) {
+        case 0x0:
+            return (op & 0xFFF0) == 0x00D0;
+        case 0x5:
+            return (op & 0xF) == 0x2 || (op & 0xF) == 0x3;
+        case 0xF:
+            return op == 0xF000 || (op & 0xFF) == 0x01 || op == 0xF002 ||
+                   (op & 0xFF) == 0x3A;
+    }
+    return false;
+}
+
+void Chip8::describe(std::ostream& out, int frames) {
+    Coverage ran;
+    setCoverage(&ran);
+    running = true;
+    for (int f = 0; f < frames && running; f++) {
+        frame();
+    }
+    setCoverage(nullptr);
+
+    const char* profile = "chip-8";
+    for (auto at : ran.touched) {
+        uint16_t op = opAt(at);
+        if (xoChipOp(op)) {
+            profile = "xo-chip";
+            break;
+        }
+        if (schipOp(op)) {
+            profile = "schip";
+        }
+    }
+
+    char word[17];
+    std::snprintf(word, sizeof(word), "%016llx", (unsigned long long)romHash);
+    out << "hash " << word << "\n";
+    out << "size " << romSize << "\n";
+    out << "profile " << profile << "\n";
+    out << "display";
+    for (auto& p : display) {
+        for (auto row : p) {
+            std::snprintf(word, sizeof(word), "%016llx", (unsigned long long)row);
+            out << " " << word;
+        }
+    }
+    out << std::endl;
+}
+
+void Chip8::runDiff(std::ostream&               out,
+                    int                         frames,
+                    int                         every,
+                    const std::vector<uint16_t>& inputs,
+                    bool                        interpret) {
+    if (loaded == false) {
+        std::cout << "No rom loaded. Please load rom and try again"
+                  << std::endl;
+        return;
+    }
+    running = true;
+
+    // whole frames go through step() so fusion and compiled code are checked
+    // as well, which only works when every line falls on a frame boundary
+    bool perFrame = !interpret && every % cycles == 0;
+
+    uint64_t hash{ fnv1a(nullptr, 0) };
+    long     count{ 0 };
+    char     line[64];
+
+    auto emit = [&]() {
+        hash = traceHash(hash);
+        std::snprintf(line,
+                      sizeof(line),
+                      "%ld %04x %04x %016llx\n",
+                      count,
+                      pc,
+                      i,
+                      static_cast<unsigned long long>(hash));
+        out << line;
+    };
+
+    for (int f = 0; f < frames && running; f++) {
+        setKeys(f < inputs.size() ? inputs[f] : 0);
+        if (perFrame) {
+            frame();
+            if (!running) {
+                break;
+            }
+            count += cycles;
+            if (count % every == 0) {
+                emit();
+            }
+            continue;
+        }
+
+        for (int c = 0; c < cycles && running; c++) {
+            tick();
+            if (running && ++count % every == 0) {
+                emit();
+            }
+        }
+        stepTimers();
+    }
+    out.flush();
+    reportFault();
+}
+
+// folds pc, i, v and the first plane of the display (a byte per pixel, row
+// major) into a running FNV-1a hash. the go core hashes exactly the same
+// bytes in its -diff mode
+uint64_t Chip8::traceHash(uint64_t hash) const {
+    std::array<byte, 20> regs{ byte(pc), byte(pc >> 8), byte(i), byte(i >> 8) };
+    std::copy(v.begin(), v.end(), regs.begin() + 4);
+    hash = fnv1a(regs.data(), regs.size(), hash);
+
+    std::array<byte, D_WIDTH> row;
+    for (int y = 0; y < D_HEIGHT; y++) {
+        for (int x = 0; x < D_WIDTH; x++) {
+            row[x] = (display[0][y] >> (D_WIDTH - 1 - x)) & 0x1;
+        }
+        hash = fnv1a(row.data(), row.size(), hash);
+    }
+    return hash;
+}
+
+// the emulator side of ipc.hpp. emulation is paced by sleeping and keeps
+// going whatever the front end does: commands are only ever polled, and a
+// fault just stops the machine until another rom is loaded or it is reset
+void Chip8::serve(SharedMemory& shm) {
+    Debugger  local;
+    Debugger* attached = debugger;
+    if (!debugger) {
+        debugger = &local;
+    }
+
+    SDL_Init(SDL_INIT_AUDIO);
+    audio.open();
+    Pacer pacer{ Pacing::Sleep, audio, TIMER_RATE };
+
+    running = loaded;
+    Command   command;
+    uint64_t  presents{ 0 };
+    bool      serving{ true };
+    Execution execution = execute();
+    metrics.start();
+    while (serving) {
+        int frames = pacer.wait();
+        metrics.mark(Phase::Wait);
+        while (serving && shm.receive(command)) {
+            serving = handleCommand(command);
+        }
+        metrics.mark(Phase::Events);
+
+        // a reset or load starts a machine that had stopped running again
+        if (running && execution.done()) {
+            execution = execute();
+        }
+
+        // a key wait just carries on, the key comes in with a later command.
+        // nothing more runs this present once the debugger stops
+        uint64_t before = retired;
+        int      ran    = 0;
+        while (ran < frames && execution.resume()) {
+            Yield why = execution.event();
+            if (why == Yield::Frame) {
+                ran++;
+            } else if (why == Yield::Break) {
+                break;
+            }
+        }
+        metrics.emulated(ran, retired - before);
+        metrics.mark(Phase::Cpu);
+
+        reportFault();
+        faultReason = nullptr;
+        publish(shm, ++presents);
+        metrics.mark(Phase::Present);
+        metrics.presented();
+        sampleMetrics();
+    }
+
+    audio.close();
+    SDL_Quit();
+    debugger = attached;
+}
+
+void Chip8::publish(SharedMemory& shm, uint64_t frame) {
+    Snapshot& s = shm.beginPublish();
+    s.frame     = frame;
+    s.v         = v;
+    s.stack     = stack;
+    s.pc        = pc;
+    s.i         = i;
+    s.sp        = sp;
+    s.dt        = dt;
+    s.st        = st;
+    s.running   = running;
+    s.paused    = debugger && debugger->paused();
+
+    const MetricsReport& m  = metrics.last();
+    s.instructionsPerSecond = m.instructions;
+    s.framesPerSecond       = m.frames;
+    s.frameTimeP99          = m.p99;
+    s.cpuShare              = m.share[static_cast<int>(Phase::Cpu)];
+
+    if (s.memoryHash != memoryHash) {
+        s.memory     = memory;
+        s.memoryHash = memoryHash;
+    }
+
+    // rows go out most significant byte first, whatever the host order
+    if (s.displayHash != displayHash) {
+        for (byte p = 0; p < PLANES; p++) {
+            for (byte r = 0; r < D_HEIGHT; r++) {
+                for (byte b = 0; b < 8; b++) {
+                    s.display[p][r * 8 + b] = display[p][r] >> (56 - b * 8);
+                }
+            }
+        }
+        s.displayHash = displayHash;
+    }
+    shm.endPublish();
+}
+
+// returns false once the front end asks to quit
+bool Chip8::handleCommand(const Command& command) {
+    switch (command.type) {
+        case CommandType::Pause:
+            debugger->pause();
+            break;
+        case CommandType::Resume:
+            debugger->resume();
+            break;
+        case CommandType::Step:
+            debugger->stepInto();
+            break;
+        case CommandType::KeyDown:
+        case CommandType::KeyUp:
+            if (command.type == CommandType::KeyDown) {
+                keys |= 1 << (command.key & 0xF);
+            } else {
+                keys &= ~(1 << (command.key & 0xF));
+            }
+            break;
+        case CommandType::Load:
+            rom = command.path;
+            [[fallthrough]];
+        case CommandType::Reset:
+            // a restart, so nothing the rom wrote (or the last rom's bytes
+            // past the end of this one) survives
+            debugger->resume();
+            init();
+            loaded  = load();
+            running = loaded;
+            if (!loaded) {
+                std::cout << "Failed to load rom: " << rom << std::endl;
+            }
+            break;
+        case CommandType::Quit:
+            return false;
+    }
+    return true;
+}
+
+// one 60hz frame: a fixed number of instructions followed by a timer tick
+void Chip8::frame() {
+    Yield why = runCycles();
+    while (why == Yield::KeyWait) {
+        why = runCycles();
+    }
+    if (why == Yield::Break) {
+        // stopped by the debugger
+        return;
+    }
+    endFrame();
+}
+
+Execution Chip8::execute() {
+    if (!loaded) {
+        co_return;
+    }
+    running = true;
+    keyWait = false;
+
+    while (running) {
+        Yield why = runCycles();
+        if (why == Yield::Frame) {
+            if (!running) {
+                break;
+            }
+            endFrame();
+        }
+        co_yield why;
+    }
+}
+
+Yield Chip8::runCycles() {
+    if (checked) {
+        return runCycles<Checked>();
+    }
+    return runCycles<Unchecked>();
+}
+
+// runs what is left of the current frame, stopping early when the debugger
+// stops (Break) or FX0A finds no key down (KeyWait). Frame once the frame's
+// instructions have all run or the machine has stopped, before endFrame()
+template <typename Policy>
+Yield Chip8::runCycles() {
+    while (frameCycle < cycles && running) {
+        int n = step<Policy>(cycles - frameCycle);
+        if (n == 0) {
+            return Yield::Break;
+        }
+        frameCycle += n;
+        retired += n;
+        if (keyWait) {
+            keyWait = false;
+            return Yield::KeyWait;
+        }
+    }
+    return Yield::Frame;
+}
+
+void Chip8::endFrame() {
+    frameCycle = 0;
+    stepTimers();
+    if (trace) {
+        trace->frame();
+    }
+}
 
-Chip8::Chip8(std::string rom, int scale)
-    : rom{ rom }, scale{ scale }, memory{}, display{} {
-    romPaths.push_back("./");
-    romPaths.push_back("./roms/");
+// executes the instruction at pc, or the whole macro-op starting there when
+// one fits in the remaining budget. returns the number of instructions run.
+// a fused op never crosses a frame boundary so timers see exactly the same
+// state they would have one instruction at a time
+template <typename Policy>
+int Chip8::step(int budget) {
+    bool single = coverage != nullptr;
+    if (debugger && debugger->armed()) {
+        if (debugger->check(pc, sp, v)) {
+            reportBreak();
+            return 0;
+        }
+        single = true;
+    }
+    // hooks fire for the instruction at pc here, and anything that runs
+    // more than one instruction at a time only does so when none of the
+    // others are hooked
+    bool hooked = hooks && hooks->armed() && !speculative;
+    if (hooked) {
+        hooks->dispatch(*this, pc);
+    }
+    if (trace) {
+        trace->begin(pc, opAt(pc));
+        tick<Policy>();
+        trace->end(i, v);
+        return 1;
+    }
+    if (single) {
+        tick<Policy>();
+        return 1;
+    }
+    if (compiled && !(hooked && hookedCompiled())) {
+        int n = compiled->run(*this, budget);
+        if (n > 0) {
+            return n;
+        }
+    }
 
-    std::string home{ std::getenv("HOME") };
-    home += "/.chip8/roms/";
-    romPaths.push_back(home);
+    Fusion f = fusion[pc];
+    if (f == Fusion::None) {
+        tick<Policy>();
+        return 1;
+    }
+    if (f == Fusion::Unknown) {
+        f = fusion[pc] = decodeFusion(pc);
+    }
+    if (hooked && f != Fusion::None &&
+        hookedWithin(pc, f == Fusion::DrawSetup ? 4 : 3)) {
+        tick<Policy>();
+        return 1;
+    }
+
+    switch (f) {
+        case Fusion::DrawSetup: {
+            if (budget < 4) {
+                break;
+            }
+            uint16_t a = opAt(pc);
+            uint16_t b = opAt(pc + 2);
+            uint16_t d = opAt(pc + 6);
+
+            v[(a >> 8) & 0xF] = a & 0xFF;
+            v[(b >> 8) & 0xF] = b & 0xFF;
+            i                 = opAt(pc + 4) & 0xFFF;
+            pc += 8;
+            sprite<Policy>((d >> 8) & 0xF, (d >> 4) & 0xF, d & 0xF);
+            return 4;
+        }
+        case Fusion::CountLoop: {
+            if (budget < 3) {
+                break;
+            }
+            uint16_t a = opAt(pc);
+            byte     x = (a >> 8) & 0xF;
+
+            // a taken skip means the jump never executes
+            v[x] += a & 0xFF;
+            if (v[x] == (opAt(pc + 2) & 0xFF)) {
+                pc += 6;
+                return 2;
+            }
+            pc = opAt(pc + 4) & 0xFFF;
+            return 3;
+        }
+        case Fusion::DelayLoop: {
+            if (budget < 3) {
+                break;
+            }
+            uint16_t start = pc;
+            uint16_t nnn   = opAt(pc + 4) & 0xFFF;
+
+            v[(opAt(pc) >> 8) & 0xF] = dt;
+            if (dt == 0) {
+                pc += 6;
+                return 2;
+            }
+
+            // waiting on itself: dt can't change before the end of the frame
+            // so every further pass leaves the machine in the same state.
+            // spend the rest of the budget in one go
+            pc = nnn;
+            if (nnn == start) {
+                return budget - budget % 3;
+            }
+            return 3;
+        }
+        default:
+            break;
+    }
+
+    tick<Policy>();
+    return 1;
+}
+
+uint16_t Chip8::opAt(uint16_t addr) {
+    return (memory[addr] << 8) | memory[uint16_t(addr + 1)];
+}
+
+Fusion Chip8::decodeFusion(uint16_t addr) {
+    if (addr > MEM_SIZE - 8) {
+        return Fusion::None;
+    }
+
+    uint16_t a = opAt(addr);
+    uint16_t b = opAt(addr + 2);
+    uint16_t c = opAt(addr + 4);
+    uint16_t d = opAt(addr + 6);
+
+    bool sameX = ((a ^ b) & 0xF00) == 0;
+
+    if (a >> 12 == 0x6 && b >> 12 == 0x6 && c >> 12 == 0xA && d >> 12 == 0xD) {
+        return Fusion::DrawSetup;
+    }
+    if (a >> 12 == 0x7 && b >> 12 == 0x3 && c >> 12 == 0x1 && sameX) {
+        return Fusion::CountLoop;
+    }
+    if ((a & 0xF0FF) == 0xF007 && (b & 0xF0FF) == 0x3000 && c >> 12 == 0x1 &&
+        sameX) {
+        return Fusion::DelayLoop;
+    }
+    return Fusion::None;
+}
+
+// a write can change any fused sequence that overlaps it, and those start at
+// most 6 bytes before the written address
+void Chip8::invalidate(uint16_t addr, int len) {
+    for (int a = addr - 6; a < addr + len; a++) {
+        fusion[uint16_t(a)] = Fusion::Unknown;
+    }
+
+    // self modifying code. the compiled blocks no longer match memory so
+    // everything goes back to the interpreter
+    if (compiled) {
+        for (int a = addr; a < addr + len; a++) {
+            if (compiledCode[uint16_t(a)]) {
+                compiled = nullptr;
+                break;
+            }
+        }
+    }
+}
+
+std::vector<CompiledRom>& compiledRoms() {
+    static std::vector<CompiledRom> roms;
+    return roms;
+}
+
+// called from static initializers in the generated code
+bool Chip8::registerCompiled(CompiledRom rom) {
+    compiledRoms().push_back(rom);
+    return true;
+}
+
+void Chip8::attachCompiled(int size) {
+    compiled    = nullptr;
+    romCompiled = nullptr;
+
+    uint64_t hash = fnv1a(memory.data() + PROGRAM_MEM_START, size);
+    for (auto& rom : compiledRoms()) {
+        if (rom.hash != hash) {
+            continue;
+        }
+
+        compiledCode.fill(false);
+        for (int r = 0; r < rom.count; r++) {
+            for (int a = rom.ranges[2 * r]; a < rom.ranges[2 * r + 1]; a++) {
+                compiledCode[a] = true;
+            }
+        }
+        compiled    = &rom;
+        romCompiled = &rom;
+        codeHash    = hashCode(memory);
+        break;
+    }
+}
+
+// the bytes of every compiled range, in order
+uint64_t Chip8::hashCode(const std::array<byte, MEM_SIZE>& from) const {
+    uint64_t hash = fnv1a(nullptr, 0);
+    for (int r = 0; r < romCompiled->count; r++) {
+        auto start = romCompiled->ranges[2 * r];
+        auto len   = romCompiled->ranges[2 * r + 1] - start;
+        hash       = fnv1a(&from[start], len, hash);
+    }
+    return hash;
+}
+
+// everything loading works out from the rom alone: the memory hash and the
+// fusion at every address of the rom, which otherwise would be decoded as
+// each is first run. it is mapped in from the cache when there is an entry,
+// and worked out all at once and written out when there isn't. an entry
+// describes the rom in otherwise fresh memory, so it is neither used nor
+// written when memory holds anything else
+void Chip8::analyse() {
+    bool     fresh = cached && freshMemory();
+    RomCache cache;
+    if (fresh && cache.open(romHash, romSize)) {
+        std::memcpy(&fusion[PROGRAM_MEM_START], cache.fusion(), romSize);
+        memoryHash = cache.header().memoryHash;
+        return;
+    }
+
+    rehash();
+    if (!fresh) {
+        return;
+    }
+    for (int a = 0; a < romSize; a++) {
+        fusion[PROGRAM_MEM_START + a] = decodeFusion(PROGRAM_MEM_START + a);
+    }
+
+    RomCacheHeader header{};
+    header.magic      = ROM_CACHE_MAGIC;
+    header.version    = ROM_CACHE_VERSION;
+    header.romHash    = romHash;
+    header.romSize    = romSize;
+    header.memoryHash = memoryHash;
+    RomCache::save(header, &fusion[PROGRAM_MEM_START]);
+}
+
+bool Chip8::record(std::string path) {
+    return audio.record(path);
+}
+
+void Chip8::setPacing(Pacing p) {
+    pacing = p;
+}
+
+void Chip8::setKeys(uint16_t mask) {
+    keys = mask;
+}
+
+void Chip8::pressKeys(uint16_t mask) {
+    keys |= mask;
+}
+
+void Chip8::setSeed(uint32_t seed) {
+    gen.seed(seed);
+}
+
+void Chip8::setMuted(bool mute) {
+    muted = mute;
+}
+
+void Chip8::setSpeculative(bool on) {
+    speculative = on;
+}
+
+const std::array<std::array<uint64_t, D_HEIGHT>, PLANES>&
+Chip8::screen() const {
+    return display;
+}
+
+void Chip8::setCoverage(Coverage* cov) {
+    coverage = cov;
+}
+
+void Chip8::setTrace(TraceWriter* writer) {
+    trace = writer;
+    if (trace) {
+        trace->header(pc, i, v);
+    }
+}
+
+void Chip8::setNetplay(Netplay* session) {
+    netplay = session;
+}
+
+void Chip8::setVideo(VideoWriter* writer) {
+    video = writer;
+    if (video) {
+        video->setPalette(palette);
+    }
+}
+
+const char* Chip8::fault() const {
+    return faultReason;
+}
+
+uint16_t Chip8::faultAt() const {
+    return faultPc;
+}
+
+void Chip8::resume() {
+    faultReason = nullptr;
+    running     = true;
+}
+
+void Chip8::trap(const char* reason, uint16_t op) {
+    faultReason = reason;
+    faultPc     = pc - 2;
+    faultOp     = op;
+    running     = false;
+}
+
+template <typename Policy>
+bool Chip8::inMemory(uint16_t addr, int len, uint16_t op) {
+    if constexpr (Policy::traps) {
+        if (addr + len > MEM_SIZE) {
+            trap("memory access past the end", op);
+            return false;
+        }
+    }
+    return true;
+}
 
-    init();
-    loaded = { load() };
-    if (!loaded) {
-        std::cout << "Failed to locate rom: " << rom << std::endl;
+void Chip8::reportFault() {
+    if (faultReason) {
+        std::cout << std::hex;
+        std::cout << "FAULT " << faultReason << " at 0x" << faultPc
+                  << " (op 0x" << faultOp << ")" << std::endl;
+        std::cout << std::dec;
     }
 }
 
-void Chip8::init() {
-    for (int i = 0; i < hexChars.size(); i++) {
-        memory[i] = hexChars[i];
+void Chip8::reportBreak() {
+    std::string why = debugger->takeMessage();
+    if (why.empty()) {
+        return;
     }
 
-    reset();
+    char line[64];
+    std::snprintf(line,
+                  sizeof(line),
+                  " at 0x%X (op 0x%04X) I %04X SP %d DT %02X ST %02X",
+                  pc,
+                  opAt(pc),
+                  i,
+                  sp,
+                  dt,
+                  st);
+    std::cout << "BREAK " << why << line << "\n ";
+    for (int r = 0; r < 16; r++) {
+        std::snprintf(line, sizeof(line), " V%X %02X", r, v[r]);
+        std::cout << line;
+    }
+    std::cout << std::endl;
 }
 
-void Chip8::reset() {
-    pc = 0x200;
-    sp = 0;
-    dt = 0;
-    st = 0;
+void Chip8::setDebugger(Debugger* dbg) {
+    debugger = dbg;
+}
 
-    for (auto& row : display) {
-        for (auto& pix : row) {
-            pix = 0;
-        }
-    }
+// whether everything outside the rom is as init() left it
+bool Chip8::freshMemory() const {
+    auto zero = [](byte b) { return b == 0; };
+    auto end  = memory.begin() + PROGRAM_MEM_START + romSize;
+    return std::equal(hexChars.begin(), hexChars.end(), memory.begin()) &&
+           std::all_of(memory.begin() + hexChars.size(),
+                       memory.begin() + PROGRAM_MEM_START,
+                       zero) &&
+           std::all_of(end, memory.end(), zero);
+}
 
-    keys[0x1] = 0;
-    keys[0x2] = 0;
-    keys[0x3] = 0;
-    keys[0xC] = 0;
-    keys[0x4] = 0;
-    keys[0x5] = 0;
-    keys[0x6] = 0;
-    keys[0xD] = 0;
-    keys[0x7] = 0;
-    keys[0x8] = 0;
-    keys[0x9] = 0;
-    keys[0xE] = 0;
-    keys[0xA] = 0;
-    keys[0x0] = 0;
-    keys[0xB] = 0;
-    keys[0xF] = 0;
+void Chip8::setHooks(Hooks* registry) {
+    hooks         = registry;
+    hooksCompiled = nullptr;
 }
 
-bool Chip8::load() {
-    for (auto romPath : romPaths) {
-        auto          fullPath = romPath + rom;
-        std::ifstream romFile{ fullPath, std::ifstream::in };
-        if (romFile) {
-            romFile.read(reinterpret_cast<char*>(memory.data()) +
-                             PROGRAM_MEM_START,
-                         fileLength(romFile));
+// whether any of the count instructions from addr are hooked
+bool Chip8::hookedWithin(uint16_t addr, int count) {
+    for (int n = 0; n < count; n++) {
+        uint16_t a = addr + 2 * n;
+        if (hooks->hooked(a, opAt(a))) {
             return true;
         }
     }
     return false;
 }
 
-void Chip8::run() {
-    if (loaded == false) {
-        std::cout << "No rom loaded. Please load rom and try again"
-                  << std::endl;
-        return;
+// whether anything in the compiled code is hooked. it only changes with the
+// hooks or the compiled code, since writing over compiled code drops it.
+// every address is looked at as an instruction, which can only turn the
+// compiled code off when it didn't need to be
+bool Chip8::hookedCompiled() {
+    if (hooksCompiled != compiled || hooksSeen != hooks->version()) {
+        hooksCompiled  = compiled;
+        hooksSeen      = hooks->version();
+        compiledHooked = false;
+        for (uint32_t a = 0; a < MEM_SIZE && !compiledHooked; a++) {
+            compiledHooked = compiledCode[a] && hooks->hooked(a, opAt(a));
+        }
     }
-    running = true;
+    return compiledHooked;
+}
 
-    SDL_Init(SDL_INIT_VIDEO & SDL_INIT_EVENTS);
-    window  = SDL_CreateWindow("Chip8",
-                              SDL_WINDOWPOS_UNDEFINED,
-                              SDL_WINDOWPOS_UNDEFINED,
-                              64 * scale,
-                              32 * scale,
-                              SDL_WINDOW_SHOWN);
-    surface = SDL_GetWindowSurface(window);
+void Chip8::setFrameDelay(int ms) {
+    frameDelay = ms;
+}
 
-    auto prev = std::chrono::steady_clock::now();
+void Chip8::setRunAhead(int frames) {
+    runAhead = frames;
+}
 
-    double delta;
-    double rate{ 1000 / 60 };
+void Chip8::setUpscale(Upscale mode) {
+    scaler.setMode(mode);
+}
 
-    while (running) {
-        auto                          now  = std::chrono::steady_clock::now();
-        std::chrono::duration<double> diff = now - prev;
+void Chip8::setOverlay(bool on) {
+    overlay = on;
+}
 
-        // TODO:INVESTIGATE
-        // Is this getting me the ms between frames???
-        delta = diff.count() * 1000;
-        prev  = now;
+void Chip8::setMetricsLog(std::ostream* out) {
+    metricsLog = out;
+}
 
-        handleEvents();
-        handleTimers(delta, rate);
-        tick();
-        draw();
+void Chip8::sampleMetrics() {
+    MetricsReport report;
+    if (!metrics.sample(report)) {
+        return;
+    }
+    if (metricsLog) {
+        Metrics::writeJson(*metricsLog, report);
+    }
+    if (overlay && window) {
+        char title[128];
+        std::snprintf(title,
+                      sizeof(title),
+                      "Chip8 - %.0f fps  %.0f ips  p99 %.1fms  cpu %.1f%%  "
+                      "drift %.0fms",
+                      report.presents,
+                      report.instructions,
+                      report.p99,
+                      report.share[static_cast<int>(Phase::Cpu)] * 100,
+                      report.drift);
+        SDL_SetWindowTitle(window, title);
     }
-    SDL_Quit();
 }
 
-void Chip8::handleTimers(double delta, double rate) {
-    static double cumulative{ 0 };
+static_assert(std::is_trivially_copyable_v<State>);
+static_assert(SCALER_WIDTH == D_WIDTH && SCALER_HEIGHT == D_HEIGHT &&
+              SCALER_PLANES == PLANES);
 
-    // hopefully this will semi accurately drop the timers at a rate of 1/60hz
-    if (cumulative >= rate) {
-        if (dt > 0) {
-            dt--;
-        }
-        if (st > 0) {
-            // this is a bit of an audio hack
-            // just playing the sound as long as needed then dropping st to 0
-            // var dur = time.Second * time.Duration(c.st) / 60
-            // speaker.Play(beep.Take(sr.N(dur), tone))
-            st = 0;
+State Chip8::save() const {
+    return State{ memory, stack, v,  display, pattern,       keys,
+                  sp,     dt,    st, plane,   pitch,         pc,
+                  i,      patternLoaded,      gen, memoryHash, displayHash };
+}
+
+void Chip8::restore(const State& state) {
+    // compiled code runs whenever the state's code is still the rom's, even
+    // if it was dropped since (as after an episode that overwrote it)
+    compiled = nullptr;
+    if (romCompiled && hashCode(state.memory) == codeHash) {
+        compiled = romCompiled;
+    }
+
+    // the fusion table still holds for every byte the state didn't change.
+    // the same memory hash means the same memory, which is the usual case
+    // for rollback and run-ahead, and then nothing needs decoding again
+    if (state.memoryHash != memoryHash) {
+        for (int a = 0; a < MEM_SIZE; a++) {
+            if (state.memory[a] != memory[a]) {
+                for (int f = a - 6; f <= a; f++) {
+                    fusion[uint16_t(f)] = Fusion::Unknown;
+                }
+            }
         }
-        cumulative = 0;
-    } else {
-        cumulative += delta;
+    }
+
+    memory        = state.memory;
+    stack         = state.stack;
+    v             = state.v;
+    display       = state.display;
+    pattern       = state.pattern;
+    keys          = state.keys;
+    sp            = state.sp;
+    dt            = state.dt;
+    st            = state.st;
+    plane         = state.plane;
+    pitch         = state.pitch;
+    pc            = state.pc;
+    i             = state.i;
+    patternLoaded = state.patternLoaded;
+    gen           = state.gen;
+    memoryHash    = state.memoryHash;
+    displayHash   = state.displayHash;
+
+    frameCycle = 0;
+}
+
+// advances both timers by one 60hz tick. the buzzer is on for exactly the
+// ticks where st is non zero so one tick worth of samples is generated here
+void Chip8::stepTimers() {
+    if (!muted) {
+        audio.generate(
+            AUDIO_RATE / TIMER_RATE, st > 0, pattern, patternLoaded, pitch);
+    }
+
+    if (dt > 0) {
+        dt--;
+    }
+    if (st > 0) {
+        st--;
     }
 }
 
@@ -177,24 +1251,89 @@ void Chip8::handleEvents() {
                 break;
             case SDL_KEYDOWN:
                 auto scancode = event.key.keysym.scancode;
+                if (debugger && !event.key.repeat) {
+                    // F5 pause/continue, F10 step over, F11 step (with
+                    // shift, step out)
+                    if (scancode == SDL_SCANCODE_F5) {
+                        if (debugger->paused()) {
+                            debugger->resume();
+                        } else {
+                            debugger->pause();
+                        }
+                    } else if (scancode == SDL_SCANCODE_F10) {
+                        debugger->stepOver(pc, opAt(pc), sp);
+                    } else if (scancode == SDL_SCANCODE_F11) {
+                        if (event.key.keysym.mod & KMOD_SHIFT) {
+                            debugger->stepOut(sp);
+                        } else {
+                            debugger->stepInto();
+                        }
+                    }
+                }
                 if (keymap.contains(scancode)) {
-                    keys[keymap[scancode]] = true;
+                    pressed |= 1 << keymap[scancode];
+                    if (!inputPending && !event.key.repeat) {
+                        inputTime    = event.key.timestamp;
+                        inputPending = true;
+                    }
                 }
                 break;
         }
     }
 }
 
+// called right after a present. the first present whose picture differs from
+// the last one after a key press is taken as the game's response to it
+void Chip8::trackLatency() {
+    if (display == presented) {
+        return;
+    }
+    presented = display;
+
+    if (inputPending) {
+        Uint32 latency = SDL_GetTicks() - inputTime;
+        latencyCount++;
+        latencyTotal += latency;
+        latencyWorst = std::max(latencyWorst, latency);
+        inputPending = false;
+    }
+}
+
+// the instance's policy picks the instantiation. the interpreter's own loop
+// picks once per frame in runCycles(), these are for everything else
+void Chip8::tick() {
+    if (checked) {
+        tick<Checked>();
+    } else {
+        tick<Unchecked>();
+    }
+}
+
+void Chip8::sprite(byte x, byte y, byte n) {
+    if (checked) {
+        sprite<Checked>(x, y, n);
+    } else {
+        sprite<Unchecked>(x, y, n);
+    }
+}
+
+template <typename Policy>
 void Chip8::tick() {
-    uint16_t op = (memory[pc] << 8) | memory[pc + 1];
+    uint16_t op = (memory[pc] << 8) | memory[uint16_t(pc + 1)];
 
-    // std::cout << std::hex;
-    // std::cout << "State:\n";
-    // std::cout << "\tOP: 0x" << op << "\n";
-    // std::cout << "\tPC: 0x" << pc << std::endl;
-    // std::cout << std::dec;
+    if (coverage) {
+        coverage->hit(pc);
+    }
 
+    // an instruction at the very end of memory wraps pc to 0 or 1, which
+    // checked builds treat as running off the end rather than into the font
     pc += 2;
+    if constexpr (Policy::traps) {
+        if (pc < 2) {
+            trap("pc past the end of memory", op);
+            return;
+        }
+    }
 
     uint16_t nnn = op & 0xFFF;
     byte     x   = (op & 0xF00) >> 8;
@@ -206,37 +1345,95 @@ void Chip8::tick() {
         case 0x0:
             switch (op & 0xFF) {
                 case 0xE0:
-                    for (auto& row : display) {
-                        for (auto& pix : row) {
-                            pix = 0x0;
+                    // only the selected planes are cleared
+                    for (byte p = 0; p < PLANES; p++) {
+                        if (plane & (1 << p)) {
+                            display[p].fill(0);
                         }
                     }
+                    rehashDisplay();
                     break;
                 case 0xEE:
-                    pc = stack[sp--];
+                    if constexpr (Policy::traps) {
+                        if (sp == 0) {
+                            trap("stack underflow", op);
+                            break;
+                        }
+                    }
+                    pc = stack[sp];
+                    sp = (sp - 1) & (stack.size() - 1);
                     break;
+                case 0xFB:
+                    scrollRight();
+                    break;
+                case 0xFC:
+                    scrollLeft();
+                    break;
+                default:
+                    switch (op & 0xF0) {
+                        case 0xC0:
+                            scrollDown(n);
+                            break;
+                        case 0xD0:
+                            scrollUp(n);
+                            break;
+                    }
             }
             break;
         case 0x1:
             pc = nnn;
             break;
         case 0x2:
-            stack[++sp] = pc;
-            pc          = nnn;
+            if constexpr (Policy::traps) {
+                if (sp == stack.size() - 1) {
+                    trap("stack overflow", op);
+                    break;
+                }
+            }
+            sp        = (sp + 1) & (stack.size() - 1);
+            stack[sp] = pc;
+            pc        = nnn;
             break;
         case 0x3:
             if (v[x] == kk) {
-                pc += 2;
+                skip();
             }
             break;
         case 0x4:
             if (v[x] != kk) {
-                pc += 2;
+                skip();
             }
             break;
         case 0x5:
-            if (v[x] == v[y]) {
-                pc += 2;
+            switch (n) {
+                case 0x0:
+                    if (v[x] == v[y]) {
+                        skip();
+                    }
+                    break;
+                // XO-CHIP register range save/load. the range may be given
+                // in either direction and i is left untouched
+                case 0x2: {
+                    if (!inMemory<Policy>(i, std::abs(x - y) + 1, op)) {
+                        break;
+                    }
+                    int step = x <= y ? 1 : -1;
+                    for (int j = 0, r = x; r != y + step; j++, r += step) {
+                        poke(i + j, v[r]);
+                    }
+                    invalidate(i, std::abs(x - y) + 1);
+                    break;
+                }
+                case 0x3: {
+                    if (!inMemory<Policy>(i, std::abs(x - y) + 1, op)) {
+                        break;
+                    }
+                    int step = x <= y ? 1 : -1;
+                    for (int j = 0, r = x; r != y + step; j++, r += step) {
+                        v[r] = memory[uint16_t(i + j)];
+                    }
+                    break;
+                }
             }
             break;
         case 0x6:
@@ -297,7 +1494,7 @@ void Chip8::tick() {
             break;
         case 0x9:
             if (v[x] != v[y]) {
-                pc += 2;
+                skip();
             }
             break;
         case 0xA:
@@ -307,94 +1504,63 @@ void Chip8::tick() {
             pc = nnn + v[0];
             break;
         case 0xC: {
-            v[x] = dist(gen) & kk;
+            // bits 23-30 of minstd_rand0, which any other core can reproduce
+            v[x] = (gen() >> 23) & kk;
             break;
         }
-        case 0xD: {
-            bool erased{ false };
-
-            for (byte i2 = 0; i2 < n; i2++) {
-                byte loc_y = v[y] + i2;
-                if (loc_y > 31) {
-                    loc_y -= 31;
-                }
-
-                byte sprite = memory[i + i2];
-                byte oldSprite{};
-
-                // Mash together display into single byte for xoring
-                for (byte j2 = 0; j2 < 8; j2++) {
-                    byte loc_x = v[x] + j2;
-                    if (loc_x > 63) {
-                        loc_x -= 63;
-                    }
-
-                    oldSprite = oldSprite | display[loc_y][loc_x];
-                    // do not bit shift left on final op, it causes a pixel to
-                    // be lost
-                    if (j2 < 7) {
-                        oldSprite = oldSprite << 1;
-                    }
-                }
-
-                sprite = sprite ^ oldSprite;
-
-                // break sprite back up into separate display bytes
-                // we use j != 255 because we are dealing with a uint
-                // and uints wrap around back to the top when they go below zero
-                // so j >= 0 would always hold true
-                for (byte j2 = 7; j2 != 255; j2--) {
-                    byte loc_x = v[x] + j2;
-                    if (loc_x > 63) {
-                        loc_x -= 63;
-                    }
-
-                    byte tmp = display[loc_y][loc_x];
-
-                    display[loc_y][loc_x] = sprite & 0x1;
-
-                    // it doesn't matter here that we go one to far with bit
-                    // shift sprite because it won't be used after the last call
-                    // anyway
-                    sprite = sprite >> 1;
-
-                    if (!erased && tmp == 0x1 && display[loc_y][loc_x] == 0x0) {
-                        v[0xF] = 1;
-                        erased = true;
-                    }
-                }
-            }
-
-            if (!erased) {
-                v[0xF] = 0;
-            }
+        case 0xD:
+            sprite<Policy>(x, y, n);
             break;
-        }
         case 0xE:
             switch (op & 0xFF) {
                 case 0x9E:
-                    if (keys[v[x]]) {
-                        pc += 2;
-                        keys[v[x]] = 0;
+                    if (keyDown(v[x])) {
+                        skip();
+                        keys &= ~(1 << v[x]);
                     }
                     break;
                 case 0xA1:
-                    if (!keys[v[x]]) {
-                        pc += 2;
+                    if (!keyDown(v[x])) {
+                        skip();
                     } else {
-                        keys[v[x]] = 0;
+                        keys &= ~(1 << v[x]);
                     }
                     break;
             }
             break;
         case 0xF:
             switch (op & 0xFF) {
+                case 0x00:
+                    // F000 NNNN: XO-CHIP long load of i from the next word
+                    i = (memory[pc] << 8) | memory[uint16_t(pc + 1)];
+                    pc += 2;
+                    break;
+                case 0x01:
+                    plane = x & ((1 << PLANES) - 1);
+                    break;
+                case 0x02:
+                    for (byte j = 0; j < pattern.size(); j++) {
+                        pattern[j] = memory[uint16_t(i + j)];
+                    }
+                    patternLoaded = true;
+                    break;
                 case 0x07:
                     v[x] = dt;
                     break;
-                case 0x0A:
-                    v[x] = waitForInput();
+                case 0x0A: {
+                    // waiting for a key just runs this instruction again
+                    // until one is down, so the rest of the machine (and the
+                    // host loop) keeps going in the meantime
+                    if (keys == 0) {
+                        pc -= 2;
+                        keyWait = true;
+                    } else {
+                        // the lowest key down wins
+                        v[x] = std::countr_zero(keys);
+                        keys &= keys - 1;
+                    }
                     break;
+                }
                 case 0x15:
                     dt = v[x];
                     break;
@@ -407,7 +1573,13 @@ void Chip8::tick() {
                 case 0x29:
                     i = v[x] * 5;
                     break;
+                case 0x3A:
+                    pitch = v[x];
+                    break;
                 case 0x33: {
+                    if (!inMemory<Policy>(i, 3, op)) {
+                        break;
+                    }
                     uint32_t bcd = v[x];
 
                     // double dabble algorithm for binary to bcd
@@ -436,19 +1608,27 @@ void Chip8::tick() {
                         bcd = bcd << 1;
                     }
 
-                    memory[i]     = (bcd & 0xF0000) >> 16;
-                    memory[i + 1] = (bcd & 0xF000) >> 12;
-                    memory[i + 2] = (bcd & 0xF00) >> 8;
+                    poke(i, (bcd & 0xF0000) >> 16);
+                    poke(i + 1, (bcd & 0xF000) >> 12);
+                    poke(i + 2, (bcd & 0xF00) >> 8);
+                    invalidate(i, 3);
                     break;
                 }
                 case 0x55:
+                    if (!inMemory<Policy>(i, x + 1, op)) {
+                        break;
+                    }
                     for (byte j = 0; j <= x; j++) {
-                        memory[i + j] = v[j];
+                        poke(i + j, v[j]);
                     }
+                    invalidate(i, x + 1);
                     break;
                 case 0x65:
+                    if (!inMemory<Policy>(i, x + 1, op)) {
+                        break;
+                    }
                     for (byte j = 0; j <= x; j++) {
-                        v[j] = memory[i + j];
+                        v[j] = memory[uint16_t(i + j)];
                     }
                     break;
             }
@@ -460,50 +1640,377 @@ void Chip8::tick() {
     }
 }
 
-byte Chip8::waitForInput() {
-    SDL_Event event;
+// skips the next instruction. F000 NNNN is the only 4 byte instruction so it
+// needs to be stepped over as a whole
+void Chip8::skip() {
+    if (memory[pc] == 0xF0 && memory[uint16_t(pc + 1)] == 0x00) {
+        pc += 4;
+    } else {
+        pc += 2;
+    }
+}
 
-    while (SDL_WaitEvent(&event)) {
-        switch (event.type) {
-            case SDL_QUIT:
-                running = false;
-                return 0xFF;
-            case SDL_KEYDOWN:
-                auto scancode = event.key.keysym.scancode;
-                if (keymap.contains(scancode)) {
-                    return keymap[scancode];
+// fast path for an 8 pixel wide sprite of height n that is entirely on
+// screen. every row is a plain shift, the rows are contiguous and the whole
+// thing unrolls. collision is a single or-reduction over all rows
+template <size_t... r>
+uint64_t blitRows(uint64_t*   rows,
+                  const byte* data,
+                  int         shift,
+                  std::index_sequence<r...>) {
+    // the trailing 0 keeps the array valid (if unused) for n == 0
+    [[maybe_unused]] const uint64_t words[]{ uint64_t(data[r]) << shift...,
+                                             0 };
+
+    uint64_t hit = (0 | ... | (rows[r] & words[r]));
+    ((rows[r] ^= words[r]), ...);
+    return hit;
+}
+
+template <size_t n>
+uint64_t blit(uint64_t* rows, const byte* data, int shift) {
+    return blitRows(rows, data, shift, std::make_index_sequence<n>{});
+}
+
+using Blit = uint64_t (*)(uint64_t*, const byte*, int);
+
+template <size_t... n> constexpr auto makeBlits(std::index_sequence<n...>) {
+    return std::array<Blit, sizeof...(n)>{ &blit<n>... };
+}
+
+const auto blits = makeBlits(std::make_index_sequence<16>{});
+
+// draws n rows of an 8 pixel wide sprite (or a 16x16 sprite when n is 0) at
+// v[x], v[y] into every selected plane. with more than one plane selected the
+// data for the next plane follows directly after the previous one
+template <typename Policy>
+void Chip8::sprite(byte x, byte y, byte n) {
+    byte     rows  = n == 0 ? 16 : n;
+    byte     width = n == 0 ? 16 : 8;
+    byte     px    = v[x] % D_WIDTH;
+    byte     py    = v[y] % D_HEIGHT;
+    uint16_t addr  = i;
+    uint64_t hit{ 0 };
+
+    bool onScreen = n != 0 && px + width <= D_WIDTH && py + rows <= D_HEIGHT;
+
+    int bytes = rows * (width / 8) * std::popcount(plane);
+    if (!inMemory<Policy>(addr, bytes, 0xD000 | (x << 8) | (y << 4) | n)) {
+        return;
+    }
+
+    for (byte p = 0; p < PLANES; p++) {
+        if (!(plane & (1 << p))) {
+            continue;
+        }
+
+        if (onScreen && addr + rows <= MEM_SIZE) {
+            int shift = D_WIDTH - 8 - px;
+            hit |= blits[n](&display[p][py], &memory[addr], shift);
+
+            for (byte r = 0; r < rows; r++) {
+                uint64_t word = uint64_t(memory[addr + r]) << shift;
+                if (word != 0) {
+                    uint32_t loc = LOC_DISPLAY + p * D_HEIGHT + py + r;
+                    uint64_t row = display[p][py + r];
+                    displayHash ^= zobrist(loc, row ^ word);
+                    displayHash ^= zobrist(loc, row);
                 }
-                break;
+            }
+            addr += rows;
+            continue;
+        }
+
+        // slow path. each sprite row is rotated into place as a whole word,
+        // which takes care of wrapping at the right edge
+        for (byte r = 0; r < rows; r++) {
+            uint64_t data = memory[addr++];
+            if (width == 16) {
+                data = (data << 8) | memory[addr++];
+            }
+
+            uint64_t word = std::rotr(data << (64 - width), px);
+            byte     ry   = (py + r) % D_HEIGHT;
+
+            hit |= display[p][ry] & word;
+            setRow(p, ry, display[p][ry] ^ word);
+        }
+    }
+
+    v[0xF] = hit != 0;
+}
+
+void Chip8::scrollDown(byte n) {
+    for (byte p = 0; p < PLANES; p++) {
+        if (plane & (1 << p)) {
+            auto& d = display[p];
+            for (int r = D_HEIGHT - 1; r >= 0; r--) {
+                d[r] = r >= n ? d[r - n] : 0;
+            }
+        }
+    }
+    rehashDisplay();
+}
+
+void Chip8::scrollUp(byte n) {
+    for (byte p = 0; p < PLANES; p++) {
+        if (plane & (1 << p)) {
+            auto& d = display[p];
+            for (int r = 0; r < D_HEIGHT; r++) {
+                d[r] = r + n < D_HEIGHT ? d[r + n] : 0;
+            }
+        }
+    }
+    rehashDisplay();
+}
+
+// horizontal scrolls move 4 pixels. since rows are packed this is a single
+// shift per row
+void Chip8::scrollLeft() {
+    for (byte p = 0; p < PLANES; p++) {
+        if (plane & (1 << p)) {
+            for (auto& row : display[p]) {
+                row <<= 4;
+            }
+        }
+    }
+    rehashDisplay();
+}
+
+void Chip8::scrollRight() {
+    for (byte p = 0; p < PLANES; p++) {
+        if (plane & (1 << p)) {
+            for (auto& row : display[p]) {
+                row >>= 4;
+            }
         }
     }
-    return 0xFF;
+    rehashDisplay();
 }
 
-// this isn't great tbh. i wish i could just draw directly to the screen
-// and scale pixel sizes as needed. such is life
-bool                                                i{ false };
+void Chip8::poke(uint16_t addr, byte value) {
+    if (debugger && debugger->watched(addr)) {
+        debugger->written(addr, memory[addr], value);
+    }
+    if (trace) {
+        trace->write(addr, value);
+    }
+    memoryHash ^= zobrist(addr, memory[addr]) ^ zobrist(addr, value);
+    memory[addr] = value;
+}
+
+void Chip8::setRow(byte p, byte r, uint64_t value) {
+    uint32_t loc = LOC_DISPLAY + p * D_HEIGHT + r;
+    displayHash ^= zobrist(loc, display[p][r]) ^ zobrist(loc, value);
+    display[p][r] = value;
+}
+
+// full recomputes, for when memory or the display change wholesale
+void Chip8::rehash() {
+    memoryHash = 0;
+    for (uint32_t a = 0; a < MEM_SIZE; a++) {
+        memoryHash ^= zobrist(a, memory[a]);
+    }
+    rehashDisplay();
+}
+
+void Chip8::rehashDisplay() {
+    displayHash = 0;
+    for (byte p = 0; p < PLANES; p++) {
+        for (byte r = 0; r < D_HEIGHT; r++) {
+            uint32_t loc = LOC_DISPLAY + p * D_HEIGHT + r;
+            displayHash ^= zobrist(loc, display[p][r]);
+        }
+    }
+}
+
+// the registers, stack, timers and keys are a fixed handful of values so they
+// are simply folded in here
+uint64_t Chip8::stateHash() const {
+    uint64_t hash = memoryHash ^ displayHash;
+    uint32_t loc  = LOC_REGS;
+
+    for (auto r : v) {
+        hash ^= zobrist(loc++, r);
+    }
+    for (auto s : stack) {
+        hash ^= zobrist(loc++, s);
+    }
+    for (auto b : pattern) {
+        hash ^= zobrist(loc++, b);
+    }
+    for (byte k = 0; k < 16; k++) {
+        hash ^= zobrist(loc++, (keys >> k) & 0x1);
+    }
+
+    hash ^= zobrist(loc++, pc);
+    hash ^= zobrist(loc++, i);
+    hash ^= zobrist(loc++, sp);
+    hash ^= zobrist(loc++, dt);
+    hash ^= zobrist(loc++, st);
+    hash ^= zobrist(loc++, plane);
+    hash ^= zobrist(loc++, pitch);
+    hash ^= zobrist(loc++, patternLoaded);
+    return hash;
+}
+
+// for surfaces that aren't 32 bit. this isn't great tbh, but they are rare
+bool                                                rectsReady{ false };
 std::array<std::array<SDL_Rect, D_WIDTH>, D_HEIGHT> rects;
 
 void Chip8::draw() {
-    if (!i) {
+    std::array<Uint32, 1 << PLANES> colors;
+
+    if (renderer) {
+        for (int c = 0; c < colors.size(); c++) {
+            colors[c] = 0xFF000000 | (palette[c][0] << 16) |
+                        (palette[c][1] << 8) | palette[c][2];
+        }
+
+        void* pixels;
+        int   stride;
+        SDL_LockTexture(texture, NULL, &pixels, &stride);
+        for (int y = 0; y < D_HEIGHT; y++) {
+            auto line = reinterpret_cast<Uint32*>(
+                static_cast<byte*>(pixels) + y * stride);
+            for (int x = 0; x < D_WIDTH; x++) {
+                line[x] = colors[pixel(x, y)];
+            }
+        }
+        SDL_UnlockTexture(texture);
+
+        SDL_RenderCopy(renderer, texture, NULL, NULL);
+        if (overlay) {
+            drawOverlay();
+        }
+        SDL_RenderPresent(renderer);
+        return;
+    }
+
+    for (int c = 0; c < colors.size(); c++) {
+        colors[c] = SDL_MapRGB(
+            surface->format, palette[c][0], palette[c][1], palette[c][2]);
+    }
+
+    // 32 bit surfaces (which is just about all of them) are written directly
+    if (surface->format->BytesPerPixel == 4) {
+        if (SDL_MUSTLOCK(surface)) {
+            SDL_LockSurface(surface);
+        }
+        scaler.draw(display,
+                    colors,
+                    scale,
+                    static_cast<Uint32*>(surface->pixels),
+                    surface->pitch);
+        if (SDL_MUSTLOCK(surface)) {
+            SDL_UnlockSurface(surface);
+        }
+        if (overlay) {
+            drawOverlay();
+        }
+        SDL_UpdateWindowSurface(window);
+        return;
+    }
+
+    if (!rectsReady) {
         for (int y = 0; y < D_HEIGHT; y++) {
             for (int x = 0; x < D_WIDTH; x++) {
                 rects[y][x] = SDL_Rect{ scale * x, scale * y, scale, scale };
             }
         }
-        i = true;
+        rectsReady = true;
     }
 
-    SDL_FillRect(surface, NULL, 0);
+    SDL_FillRect(surface, NULL, colors[0]);
     for (int y = 0; y < D_HEIGHT; y++) {
         for (int x = 0; x < D_WIDTH; x++) {
-            if (display[y][x] == 0x1) {
-                SDL_FillRect(surface,
-                             &rects[y][x],
-                             SDL_MapRGB(surface->format, 0, 255, 255));
+            int c = pixel(x, y);
+            if (c != 0) {
+                SDL_FillRect(surface, &rects[y][x], colors[c]);
             }
         }
     }
+    if (overlay) {
+        drawOverlay();
+    }
 
     SDL_UpdateWindowSurface(window);
 }
+
+// presents per second and p99 frame time (ms) in the top left, in the rom
+// font, and a bar per present along the bottom. bars are red once a present
+// took more than one and a half 60hz frames
+void Chip8::drawOverlay() {
+    const MetricsReport& report = metrics.last();
+
+    int dot    = std::max(scale / 5, 2);
+    int width  = D_WIDTH * scale;
+    int height = D_HEIGHT * scale;
+
+    // 2 numbers of up to 4 digits, 4x5 dots each
+    std::array<SDL_Rect, 2 * 4 * 20> text;
+    int                              count = 0;
+
+    int lines[2] = { int(report.presents + 0.5), int(report.p99 + 0.5) };
+    for (int l = 0; l < 2; l++) {
+        char digits[12];
+        std::snprintf(digits, sizeof(digits), "%d", std::clamp(lines[l], 0, 9999));
+        for (int d = 0; digits[d]; d++) {
+            for (int row = 0; row < 5; row++) {
+                byte bits = hexChars[(digits[d] - '0') * 5 + row];
+                for (int col = 0; col < 4; col++) {
+                    if (bits & (0x80 >> col)) {
+                        text[count++] = SDL_Rect{ dot * (1 + d * 5 + col),
+                                                  dot * (1 + l * 6 + row),
+                                                  dot,
+                                                  dot };
+                    }
+                }
+            }
+        }
+    }
+    fillOverlay(text.data(), count, 0xFFFFFF);
+
+    std::array<SDL_Rect, METRICS_GRAPH> good;
+    std::array<SDL_Rect, METRICS_GRAPH> slow;
+    int                                 goodCount = 0;
+    int                                 slowCount = 0;
+
+    // a third of the window is 50ms
+    auto  times  = metrics.graph();
+    int   barW   = width / METRICS_GRAPH;
+    float budget = 1.5f * 1000 / TIMER_RATE;
+    for (int b = 0; b < METRICS_GRAPH; b++) {
+        int      h   = std::min(times[b] / 50.0f, 1.0f) * (height / 3);
+        SDL_Rect bar = { b * barW, height - h, std::max(barW - 1, 1), h };
+        if (times[b] > budget) {
+            slow[slowCount++] = bar;
+        } else {
+            good[goodCount++] = bar;
+        }
+    }
+    fillOverlay(good.data(), goodCount, 0x00FF00);
+    fillOverlay(slow.data(), slowCount, 0xFF0000);
+}
+
+void Chip8::fillOverlay(const SDL_Rect* rects, int count, Uint32 rgb) {
+    byte r = rgb >> 16, g = rgb >> 8, b = rgb;
+    if (renderer) {
+        SDL_SetRenderDrawColor(renderer, r, g, b, 0xFF);
+        SDL_RenderFillRects(renderer, rects, count);
+        return;
+    }
+    Uint32 color = SDL_MapRGB(surface->format, r, g, b);
+    for (int n = 0; n < count; n++) {
+        SDL_FillRect(surface, &rects[n], color);
+    }
+}
+
+// palette index of a pixel, made up of its bit in each plane
+int Chip8::pixel(int x, int y) {
+    int c{ 0 };
+    for (int p = 0; p < PLANES; p++) {
+        c |= ((display[p][y] >> (D_WIDTH - 1 - x)) & 0x1) << p;
+    }
+    return c;
+}
@@ -0,0 +1,218 @@
+#include <cctype>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "debugger.hpp"
+
+bool Condition::holds(const std::array<byte, 16>& v) const {
+    switch (compare) {
+        case Compare::Equal:
+            return v[reg] == value;
+        case Compare::NotEqual:
+            return v[reg] != value;
+        case Compare::Less:
+            return v[reg] < value;
+        case Compare::Greater:
+            return v[reg] > value;
+    }
+    return false;
+}
+
+Debugger::Debugger()
+    : breaks{}, breakCount{ 0 }, watches{}, watchCount{ 0 }, halted{ false },
+      skip{ false }, mode{ StepMode::None }, target{ 0 }, depth{ 0 } {}
+
+void Debugger::setBreakpoint(uint16_t addr) {
+    uint64_t bit = uint64_t(1) << (addr & 63);
+    if (!(breaks[addr >> 6] & bit)) {
+        breaks[addr >> 6] |= bit;
+        breakCount++;
+    }
+}
+
+void Debugger::setBreakpoint(uint16_t addr, Condition condition) {
+    setBreakpoint(addr);
+    conditions[addr].push_back(condition);
+}
+
+void Debugger::clearBreakpoint(uint16_t addr) {
+    uint64_t bit = uint64_t(1) << (addr & 63);
+    if (breaks[addr >> 6] & bit) {
+        breaks[addr >> 6] &= ~bit;
+        breakCount--;
+    }
+    conditions.erase(addr);
+}
+
+bool Debugger::addBreakpoint(std::string spec) {
+    try {
+        size_t   end;
+        uint16_t addr = std::stoi(spec, &end, 16);
+        if (end == spec.size()) {
+            setBreakpoint(addr);
+            return true;
+        }
+
+        // addr:VX op NN
+        std::string cond = spec.substr(end + 1);
+        if (spec[end] != ':' || cond.size() < 4 || toupper(cond[0]) != 'V') {
+            throw std::invalid_argument(spec);
+        }
+
+        Condition condition;
+        condition.reg = std::stoi(cond.substr(1, 1), nullptr, 16);
+
+        std::string op = cond.substr(2, cond[3] == '=' ? 2 : 1);
+        if (op == "==") {
+            condition.compare = Compare::Equal;
+        } else if (op == "!=") {
+            condition.compare = Compare::NotEqual;
+        } else if (op == "<") {
+            condition.compare = Compare::Less;
+        } else if (op == ">") {
+            condition.compare = Compare::Greater;
+        } else {
+            throw std::invalid_argument(spec);
+        }
+        condition.value = std::stoi(cond.substr(2 + op.size()), nullptr, 16);
+
+        setBreakpoint(addr, condition);
+        return true;
+    } catch (const std::exception&) {
+        std::cout << "Bad breakpoint: " << spec << std::endl;
+        return false;
+    }
+}
+
+void Debugger::watch(uint16_t addr, int len) {
+    for (int a = addr; a < addr + len && a < MEM_SIZE; a++) {
+        watchCount += !watches[a];
+        watches[a] = true;
+    }
+}
+
+void Debugger::unwatch(uint16_t addr, int len) {
+    for (int a = addr; a < addr + len && a < MEM_SIZE; a++) {
+        watchCount -= watches[a];
+        watches[a] = false;
+    }
+}
+
+bool Debugger::addWatch(std::string spec) {
+    try {
+        size_t   end;
+        uint16_t addr = std::stoi(spec, &end, 16);
+        int      len  = 1;
+        if (end < spec.size()) {
+            if (spec[end] != ':') {
+                throw std::invalid_argument(spec);
+            }
+            len = std::stoi(spec.substr(end + 1), nullptr, 16);
+        }
+        watch(addr, len);
+        return true;
+    } catch (const std::exception&) {
+        std::cout << "Bad watchpoint: " << spec << std::endl;
+        return false;
+    }
+}
+
+void Debugger::pause() {
+    if (!halted) {
+        halt("paused");
+    }
+}
+
+void Debugger::resume() {
+    halted = false;
+    skip   = true;
+    mode   = StepMode::None;
+}
+
+void Debugger::stepInto() {
+    resume();
+    mode = StepMode::Into;
+}
+
+// over a call this runs until it returns to the next instruction at the same
+// depth. anything else is a plain step
+void Debugger::stepOver(uint16_t pc, uint16_t op, byte sp) {
+    resume();
+    if (op >> 12 == 0x2) {
+        mode   = StepMode::Over;
+        target = pc + 2;
+        depth  = sp;
+    } else {
+        mode = StepMode::Into;
+    }
+}
+
+void Debugger::stepOut(byte sp) {
+    resume();
+    if (sp > 0) {
+        mode  = StepMode::Out;
+        depth = sp;
+    }
+}
+
+bool Debugger::check(uint16_t pc, byte sp, const std::array<byte, 16>& v) {
+    if (halted) {
+        return true;
+    }
+    if (skip) {
+        skip = false;
+        return false;
+    }
+
+    switch (mode) {
+        case StepMode::Into:
+            return halt("step");
+        case StepMode::Over:
+            if (pc == target && sp == depth) {
+                return halt("step over");
+            }
+            break;
+        case StepMode::Out:
+            if (sp < depth) {
+                return halt("step out");
+            }
+            break;
+        case StepMode::None:
+            break;
+    }
+
+    if (breaks[pc >> 6] & (uint64_t(1) << (pc & 63))) {
+        auto found = conditions.find(pc);
+        if (found == conditions.end()) {
+            return halt("breakpoint");
+        }
+        for (auto& condition : found->second) {
+            if (condition.holds(v)) {
+                return halt("conditional breakpoint");
+            }
+        }
+    }
+    return false;
+}
+
+void Debugger::written(uint16_t addr, byte old, byte value) {
+    char buf[64];
+    std::snprintf(
+        buf, sizeof(buf), "watchpoint 0x%X: %02X -> %02X", addr, old, value);
+    halt(buf);
+}
+
+bool Debugger::halt(std::string why) {
+    halted = true;
+    mode   = StepMode::None;
+    message += message.empty() ? why : ", " + why;
+    return true;
+}
+
+std::string Debugger::takeMessage() {
+    std::string taken;
+    std::swap(taken, message);
+    return taken;
+}
@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// chip8-diff: runs two cores side by side and reports where their traces
+// first disagree. each command is run through a pipe and is expected to print
+// the "count pc i hash" lines of a --diff run (or the go core's -diff), e.g.
+//
+//   chip8-diff "./chip8 PONG --headless 600 --diff 10"
+//              "../../go/chip8 -r ../../roms/PONG --frames 600 --diff 10"
+//
+// usage: chip8-diff command-a command-b
+
+bool readLine(std::FILE* pipe, std::string& line) {
+    line.clear();
+    int c;
+    while ((c = std::fgetc(pipe)) != EOF && c != '\n') {
+        line += char(c);
+    }
+    return c != EOF || !line.empty();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cout << "usage: chip8-diff command-a command-b" << std::endl;
+        return 1;
+    }
+
+    std::FILE* a = popen(argv[1], "r");
+    std::FILE* b = popen(argv[2], "r");
+    if (!a || !b) {
+        std::cout << "Failed to start: " << (a ? argv[2] : argv[1])
+                  << std::endl;
+        return 1;
+    }
+
+    std::string lineA, lineB, last;
+    long        lines{ 0 };
+    int         result{ 0 };
+
+    while (true) {
+        bool moreA = readLine(a, lineA);
+        bool moreB = readLine(b, lineB);
+        if (!moreA && !moreB) {
+            std::cout << "traces match (" << lines << " lines)" << std::endl;
+            break;
+        }
+        if (moreA && moreB && lineA == lineB) {
+            last = lineA;
+            lines++;
+            continue;
+        }
+
+        std::cout << "first divergence after " << lines << " lines" << std::endl;
+        if (!last.empty()) {
+            std::cout << "  last match: " << last << std::endl;
+        }
+        std::cout << "  a: " << (moreA ? lineA : "<end of trace>") << std::endl;
+        std::cout << "  b: " << (moreB ? lineB : "<end of trace>") << std::endl;
+        result = 1;
+        break;
+    }
+
+    pclose(a);
+    pclose(b);
+    return result;
+}
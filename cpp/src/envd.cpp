@@ -0,0 +1,305 @@
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "chip8.hpp"
+#include "envd.hpp"
+#include "pool.hpp"
+
+// chip8-envd: serves headless instances of a rom as environments over a unix
+// socket, see envd.hpp for the protocol
+//
+// usage: chip8-envd rom [--envs n] [--socket path]
+
+static_assert(ENVD_WIDTH == D_WIDTH && ENVD_HEIGHT == D_HEIGHT &&
+              ENVD_PLANES == PLANES);
+
+#define DEFAULT_ENVS 64
+#define DEFAULT_SOCKET "/tmp/chip8-envd.sock"
+
+static volatile std::sig_atomic_t stopping = 0;
+
+void stop(int) {
+    stopping = 1;
+}
+
+struct Env {
+    Chip8*   chip8;
+    uint64_t frame;
+};
+
+class EnvServer {
+  public:
+    EnvServer(std::string rom, int count);
+    ~EnvServer();
+
+    bool open(std::string socketPath);
+    void serve();
+
+  private:
+    // resetting an environment goes back to the pool's state for the rom,
+    // so a rom that writes to itself doesn't carry anything over between
+    // episodes
+    Chip8Pool        pool;
+    std::vector<Env> envs;
+
+    std::string  shmName;
+    EnvHeader*   header;
+    Observation* observations;
+    size_t       mapped;
+
+    std::string socketPath;
+    int         listener;
+
+    // slots of the request being handled, kept to avoid allocating per
+    // request
+    std::vector<EnvSlot> slots;
+
+    void      handle(int client);
+    EnvStatus run(const EnvRequest& request);
+    void      observe(uint32_t e);
+};
+
+bool readFully(int fd, void* buf, size_t len) {
+    auto* at = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = read(fd, at, len);
+        if (n <= 0) {
+            return false;
+        }
+        at += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool writeFully(int fd, const void* buf, size_t len) {
+    auto* at = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t n = write(fd, at, len);
+        if (n <= 0) {
+            return false;
+        }
+        at += n;
+        len -= n;
+    }
+    return true;
+}
+
+EnvServer::EnvServer(std::string rom, int count)
+    : pool{ rom, count }, header{ nullptr }, observations{ nullptr },
+      mapped{ 0 }, listener{ -1 } {
+    if (!pool.isLoaded()) {
+        return;
+    }
+    for (int e = 0; e < count; e++) {
+        envs.push_back({ pool.acquire(), 0 });
+    }
+    slots.reserve(ENVD_MAX_ENVS);
+}
+
+EnvServer::~EnvServer() {
+    if (listener >= 0) {
+        close(listener);
+        unlink(socketPath.c_str());
+    }
+    if (header) {
+        munmap(header, mapped);
+        shm_unlink(shmName.c_str());
+    }
+}
+
+bool EnvServer::open(std::string path) {
+    if (envs.empty()) {
+        return false;
+    }
+
+    shmName = "/chip8-envd-" + std::to_string(getpid());
+    mapped  = sizeof(EnvHeader) + envs.size() * sizeof(Observation);
+    int fd  = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, mapped) != 0) {
+        std::cout << "Failed to create shared memory: " << shmName
+                  << std::endl;
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(shmName.c_str());
+        }
+        return false;
+    }
+    void* shm =
+        mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        std::cout << "Failed to map shared memory: " << shmName << std::endl;
+        shm_unlink(shmName.c_str());
+        return false;
+    }
+    header       = static_cast<EnvHeader*>(shm);
+    observations = reinterpret_cast<Observation*>(header + 1);
+    *header      = { ENVD_MAGIC, ENVD_VERSION, uint32_t(envs.size()), 0 };
+    for (uint32_t e = 0; e < envs.size(); e++) {
+        observe(e);
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cout << "Socket path too long: " << path << std::endl;
+        return false;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 ||
+        bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) !=
+            0 ||
+        listen(listener, 1) != 0) {
+        std::cout << "Failed to listen on " << path << std::endl;
+        return false;
+    }
+    socketPath = path;
+    return true;
+}
+
+// clients are served one at a time. they all see the same environments, so
+// there is nothing to gain from interleaving them
+void EnvServer::serve() {
+    std::cout << "Serving " << envs.size() << " environments on "
+              << socketPath << std::endl;
+    while (!stopping) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        handle(client);
+        close(client);
+    }
+}
+
+void EnvServer::handle(int client) {
+    EnvRequest request;
+    while (!stopping && readFully(client, &request, sizeof(request))) {
+        EnvReply reply{ ENVD_MAGIC, ENVD_VERSION, EnvStatus::Ok, 0, {} };
+
+        // past this there is no telling where the next request starts, so
+        // the client is dropped. anything else refused is read in full
+        if (request.count > ENVD_MAX_ENVS) {
+            return;
+        }
+        slots.resize(request.count);
+        if (!readFully(client, slots.data(), request.count * sizeof(EnvSlot))) {
+            return;
+        }
+
+        if (request.op == EnvOp::Hello) {
+            reply.count = envs.size();
+            std::strncpy(reply.name, shmName.c_str() + 1, ENVD_NAME - 1);
+        } else {
+            reply.status = run(request);
+            reply.count  = request.count;
+        }
+        if (!writeFully(client, &reply, sizeof(reply))) {
+            return;
+        }
+    }
+}
+
+EnvStatus EnvServer::run(const EnvRequest& request) {
+    for (auto& slot : slots) {
+        if (slot.env >= envs.size()) {
+            return EnvStatus::BadEnv;
+        }
+    }
+
+    switch (request.op) {
+        case EnvOp::Reset:
+            for (auto& slot : slots) {
+                Env& env = envs[slot.env];
+                pool.reset(*env.chip8);
+                env.chip8->setSeed(slot.arg);
+                env.frame = 0;
+                observe(slot.env);
+            }
+            return EnvStatus::Ok;
+        case EnvOp::Step:
+            if (request.frames > ENVD_MAX_FRAMES) {
+                return EnvStatus::BadRequest;
+            }
+            for (auto& slot : slots) {
+                Env& env = envs[slot.env];
+                env.chip8->setKeys(slot.arg);
+                for (uint32_t f = 0; f < request.frames && !env.chip8->fault();
+                     f++) {
+                    env.chip8->frame();
+                    env.frame++;
+                }
+                observe(slot.env);
+            }
+            return EnvStatus::Ok;
+        case EnvOp::Observe:
+            for (auto& slot : slots) {
+                observe(slot.env);
+            }
+            return EnvStatus::Ok;
+        default:
+            return EnvStatus::BadRequest;
+    }
+}
+
+void EnvServer::observe(uint32_t e) {
+    const Env&   env = envs[e];
+    Observation& obs = observations[e];
+    obs.frame        = env.frame;
+    obs.stateHash    = env.chip8->stateHash();
+    std::memcpy(&obs.display, env.chip8->screen().data(), sizeof(obs.display));
+    obs.done = env.chip8->fault() != nullptr;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "usage: chip8-envd rom [--envs n] [--socket path]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string rom{ argv[1] };
+    int         count{ DEFAULT_ENVS };
+    std::string socketPath{ DEFAULT_SOCKET };
+    for (int a = 2; a < argc; a++) {
+        std::string arg{ argv[a] };
+        if (arg == "--envs" && a + 1 < argc) {
+            count = std::stoi(argv[++a]);
+        } else if (arg == "--socket" && a + 1 < argc) {
+            socketPath = argv[++a];
+        }
+    }
+    if (count < 1 || count > ENVD_MAX_ENVS) {
+        std::cout << "Environments must be between 1 and " << ENVD_MAX_ENVS
+                  << std::endl;
+        return 1;
+    }
+
+    // without SA_RESTART a signal breaks accept and read out so the socket
+    // and shared memory get cleaned up
+    struct sigaction action {};
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    EnvServer server{ rom, count };
+    if (!server.open(socketPath)) {
+        return 1;
+    }
+    server.serve();
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "explore.hpp"
+
+// frames played per mutation
+#define MIN_RUN 10
+#define MAX_RUN 120
+
+// chance per frame of switching to a different key (or to none)
+#define KEY_CHANGE 0.1
+
+Explorer::Explorer(std::string rom, int threads)
+    : rom{ rom }, threads{ threads }, frames{ 0 }, runs{ 0 } {
+    for (auto& c : covered) {
+        c = false;
+    }
+}
+
+void Explorer::run(double seconds) {
+    Chip8 root{ rom, 1 };
+    if (!root.isLoaded()) {
+        return;
+    }
+    corpus.push_back({ root.save(), {} });
+    hashes.insert(root.stateHash());
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back(&Explorer::work, this, t, seconds);
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+void Explorer::work(int seed, double seconds) {
+    using clock = std::chrono::steady_clock;
+
+    auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(
+                                       std::chrono::duration<double>(seconds));
+
+    std::mt19937                     rng(seed);
+    std::uniform_real_distribution<> chance(0, 1);
+    std::uniform_int_distribution<>  length(MIN_RUN, MAX_RUN);
+    std::uniform_int_distribution<>  key(-1, 15);
+
+    // always Checked, an Unchecked machine never crashes to be found
+    Chip8    chip8{ rom, 1, true, Safety::Checked };
+    Coverage coverage;
+    chip8.setCoverage(&coverage);
+
+    std::vector<uint16_t> inputs;
+
+    while (clock::now() < deadline) {
+        // pick a starting point, leaning towards recent finds since those
+        // are the ones at the frontier
+        Entry start;
+        {
+            std::lock_guard<std::mutex> guard{ lock };
+            std::uniform_int_distribution<size_t> pick(0, corpus.size() - 1);
+            size_t                                idx = pick(rng);
+            if (chance(rng) < 0.5) {
+                idx = std::max(idx, pick(rng));
+            }
+            start = corpus[idx];
+        }
+
+        chip8.restore(start.state);
+        chip8.resume();
+        coverage.clear();
+        inputs.clear();
+
+        uint16_t mask{ 0 };
+        int      n = length(rng);
+        for (int f = 0; f < n && !chip8.fault(); f++) {
+            if (chance(rng) < KEY_CHANGE) {
+                int k = key(rng);
+                mask  = k < 0 ? 0 : 1 << k;
+            }
+            chip8.setKeys(mask);
+            chip8.frame();
+            inputs.push_back(mask);
+        }
+        frames += inputs.size();
+        runs++;
+
+        bool fresh{ false };
+        for (auto pc : coverage.touched) {
+            if (!covered[pc].exchange(true)) {
+                fresh = true;
+            }
+        }
+
+        if (!fresh && !chip8.fault()) {
+            continue;
+        }
+
+        auto path = start.inputs;
+        path.insert(path.end(), inputs.begin(), inputs.end());
+
+        std::lock_guard<std::mutex> guard{ lock };
+        // crashes are kept once per kind of fault and pc
+        if (chip8.fault()) {
+            if (crashSites.insert({ chip8.fault(), chip8.faultAt() }).second) {
+                crashes.push_back({ chip8.fault(), chip8.faultAt(), path });
+            }
+        } else if (hashes.insert(chip8.stateHash()).second) {
+            corpus.push_back({ chip8.save(), path });
+        }
+    }
+}
+
+// prints a summary and writes each crash to crashDir as the fault followed by
+// one hex key mask per frame, which is enough to replay it from reset
+void Explorer::report(std::string crashDir) {
+    int count{ 0 };
+    for (auto& c : covered) {
+        count += c;
+    }
+
+    std::cout << "runs: " << runs << ", frames: " << frames
+              << ", corpus: " << corpus.size() << ", covered pcs: " << count
+              << ", crashes: " << crashes.size() << std::endl;
+
+    for (size_t c = 0; c < crashes.size(); c++) {
+        std::cout << "  " << crashes[c].fault << " at 0x" << std::hex
+                  << crashes[c].pc << std::dec << " after "
+                  << crashes[c].inputs.size() << " frames" << std::endl;
+
+        if (crashDir.empty()) {
+            continue;
+        }
+        std::ofstream out{ crashDir + "/crash-" + std::to_string(c) + ".txt" };
+        out << crashes[c].fault << "\n" << std::hex;
+        for (auto mask : crashes[c].inputs) {
+            out << mask << "\n";
+        }
+    }
+}
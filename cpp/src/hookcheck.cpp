@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "chip8.hpp"
+#include "hooks.hpp"
+
+// chip8-hookcheck: runs a rom twice, once with plain counting hooks and once
+// with the same hooks mixed in with ones that remove themselves and each
+// other part way through, and checks the counting hooks saw the same thing
+// both times. none of the hooks touch the machine, so the state has to come
+// out the same as with no hooks at all
+//
+// usage: chip8-hookcheck [rom] [frames]
+
+struct Counts {
+    int      starts{ 0 };
+    int      draws{ 0 };
+    long     instructions{ 0 };
+    uint64_t hash{ 0 };
+};
+
+// counting hooks: one on the entry point, one on every DXYN and one on every
+// instruction
+void count(Hooks& hooks, Counts& counts) {
+    hooks.onPc(PROGRAM_MEM_START, [&](HookContext&) { counts.starts++; });
+    hooks.onOpcode(0xF000, 0xD000, [&](HookContext&) { counts.draws++; });
+    hooks.onOpcode(0x0000, 0x0000, [&](HookContext&) {
+        counts.instructions++;
+    });
+}
+
+Counts run(std::string rom, int frames, bool removing) {
+    Chip8  chip8{ rom, 1 };
+    Hooks  hooks;
+    Counts counts;
+    if (!chip8.isLoaded()) {
+        return counts;
+    }
+    chip8.setMuted(true);
+
+    int removed{ 0 };
+    int victimRuns{ 0 };
+    if (removing) {
+        // first in line: removes itself the first time it runs, which moves
+        // every hook after it down
+        int self = hooks.onOpcode(0xF000, 0xD000, [&](HookContext&) {});
+        hooks.remove(self);
+        self = hooks.onOpcode(0xF000, 0xD000, [&](HookContext&) {
+            removed++;
+            hooks.remove(self);
+        });
+
+        // removed by the hook after it, once it has run once
+        int victim = hooks.onPc(PROGRAM_MEM_START, [&](HookContext&) {
+            victimRuns++;
+        });
+        hooks.onPc(PROGRAM_MEM_START, [&](HookContext&) {
+            hooks.remove(victim);
+        });
+    }
+    count(hooks, counts);
+    chip8.setHooks(&hooks);
+
+    chip8.runHeadless(frames, {});
+    counts.hash = chip8.stateHash();
+
+    if (removing && (removed != 1 || victimRuns != 1)) {
+        std::cout << "removing hooks ran " << removed << " and " << victimRuns
+                  << " times, expected once each" << std::endl;
+        counts.hash = ~counts.hash;
+    }
+    return counts;
+}
+
+int main(int argc, char** argv) {
+    std::string rom    = argc > 1 ? argv[1] : "BRIX";
+    int         frames = argc > 2 ? std::stoi(argv[2]) : 600;
+
+    Chip8 plain{ rom, 1 };
+    if (!plain.isLoaded()) {
+        return 1;
+    }
+    plain.setMuted(true);
+    plain.runHeadless(frames, {});
+
+    Counts counted  = run(rom, frames, false);
+    Counts removing = run(rom, frames, true);
+
+    char line[160];
+    std::snprintf(line,
+                  sizeof(line),
+                  "%d starts, %d draws, %ld instructions",
+                  counted.starts,
+                  counted.draws,
+                  counted.instructions);
+    std::cout << line << std::endl;
+
+    int result{ 0 };
+    if (counted.hash != plain.stateHash()) {
+        std::cout << "hooks changed the machine's state" << std::endl;
+        result = 1;
+    }
+    if (removing.starts != counted.starts || removing.draws != counted.draws ||
+        removing.instructions != counted.instructions ||
+        removing.hash != counted.hash) {
+        std::snprintf(line,
+                      sizeof(line),
+                      "with removals: %d starts, %d draws, %ld instructions",
+                      removing.starts,
+                      removing.draws,
+                      removing.instructions);
+        std::cout << line << std::endl;
+        result = 1;
+    }
+    std::cout << (result ? "FAILED" : "ok") << std::endl;
+    return result;
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include "hooks.hpp"
+
+HookContext::HookContext(Chip8& chip8, uint16_t op)
+    : chip8{ chip8 }, opcode{ op } {}
+
+uint16_t HookContext::pc() const {
+    return chip8.pc;
+}
+
+uint16_t HookContext::op() const {
+    return opcode;
+}
+
+byte HookContext::reg(byte r) const {
+    return chip8.v[r & 0xF];
+}
+
+void HookContext::setReg(byte r, byte value) {
+    chip8.v[r & 0xF] = value;
+}
+
+uint16_t HookContext::index() const {
+    return chip8.i;
+}
+
+void HookContext::setIndex(uint16_t value) {
+    chip8.i = value;
+}
+
+byte HookContext::peek(uint16_t addr) const {
+    return chip8.memory[addr];
+}
+
+// through the same path as a store by the rom, so hashes, fused ops and
+// compiled code all see it
+void HookContext::poke(uint16_t addr, byte value) {
+    chip8.poke(addr, value);
+    chip8.invalidate(addr, 1);
+}
+
+Chip8& HookContext::machine() {
+    return chip8;
+}
+
+Hooks::Hooks()
+    : pcs{}, ops{}, nextId{ 0 }, changes{ 0 }, byOpcode{ false } {}
+
+int Hooks::onPc(uint16_t addr, Hook hook) {
+    entries.push_back(Entry{ nextId, true, 0xFFFF, addr, std::move(hook) });
+    mark(entries.back());
+    return nextId++;
+}
+
+int Hooks::onOpcode(uint16_t mask, uint16_t match, Hook hook) {
+    entries.push_back(
+        Entry{ nextId, false, mask, uint16_t(match & mask), std::move(hook) });
+    mark(entries.back());
+    return nextId++;
+}
+
+void Hooks::remove(int id) {
+    std::erase_if(entries, [&](const Entry& e) { return e.id == id; });
+
+    // bits can be shared between hooks, so they are all worked out again
+    changes++;
+    pcs.fill(0);
+    ops.fill(0);
+    byOpcode = false;
+    for (const Entry& entry : entries) {
+        mark(entry);
+    }
+}
+
+void Hooks::mark(const Entry& entry) {
+    changes++;
+    if (entry.byPc) {
+        pcs[entry.match >> 6] |= uint64_t(1) << (entry.match & 63);
+        return;
+    }
+    byOpcode = true;
+    for (uint32_t op = 0; op < (1 << 16); op++) {
+        if ((op & entry.mask) == entry.match) {
+            ops[op >> 6] |= uint64_t(1) << (op & 63);
+        }
+    }
+}
+
+// hooks run in the order they were added. one can add or remove hooks
+// (itself included), which moves the entries around, so the ones that match
+// are found first and then looked up by id as they come up. a hook removed
+// before its turn doesn't run, and one added waits for the next instruction
+void Hooks::fire(Chip8& chip8, uint16_t pc, uint16_t op) {
+    std::vector<int> due;
+    for (const Entry& entry : entries) {
+        uint16_t value = entry.byPc ? pc : op;
+        if ((value & entry.mask) == entry.match) {
+            due.push_back(entry.id);
+        }
+    }
+
+    HookContext context{ chip8, op };
+    for (int id : due) {
+        auto entry = std::find_if(entries.begin(),
+                                  entries.end(),
+                                  [&](const Entry& e) { return e.id == id; });
+        if (entry != entries.end()) {
+            Hook hook = entry->hook;
+            hook(context);
+        }
+    }
+}
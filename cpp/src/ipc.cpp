@@ -0,0 +1,132 @@
+#include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ipc.hpp"
+
+SharedMemory::SharedMemory() : state{ nullptr }, owner{ false } {}
+
+SharedMemory::~SharedMemory() {
+    close();
+}
+
+bool SharedMemory::create(std::string shmName) {
+    name   = "/" + shmName;
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, sizeof(SharedState)) != 0) {
+        std::cout << "Failed to create shared memory: " << name << std::endl;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+
+    void* mapped = mmap(nullptr,
+                        sizeof(SharedState),
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED,
+                        fd,
+                        0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cout << "Failed to map shared memory: " << name << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // a segment left behind by an emulator that died is simply reused. the
+    // magic goes in last so a front end never attaches to a half set up one
+    state          = new (mapped) SharedState{};
+    state->version = IPC_VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    state->magic = IPC_MAGIC;
+    owner        = true;
+    return true;
+}
+
+bool SharedMemory::attach(std::string shmName) {
+    name   = "/" + shmName;
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(SharedState)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapped = mmap(nullptr,
+                        sizeof(SharedState),
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED,
+                        fd,
+                        0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    state = static_cast<SharedState*>(mapped);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (state->magic != IPC_MAGIC || state->version != IPC_VERSION) {
+        munmap(state, sizeof(SharedState));
+        state = nullptr;
+        return false;
+    }
+    owner = false;
+    return true;
+}
+
+void SharedMemory::close() {
+    if (!state) {
+        return;
+    }
+    munmap(state, sizeof(SharedState));
+    if (owner) {
+        shm_unlink(name.c_str());
+    }
+    state = nullptr;
+}
+
+bool SharedMemory::isOpen() const {
+    return state != nullptr;
+}
+
+Snapshot& SharedMemory::beginPublish() {
+    uint32_t seq = state->sequence.load(std::memory_order_relaxed);
+    state->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return state->snapshot;
+}
+
+void SharedMemory::endPublish() {
+    uint32_t seq = state->sequence.load(std::memory_order_relaxed);
+    state->sequence.store(seq + 1, std::memory_order_release);
+}
+
+bool SharedMemory::receive(Command& command) {
+    uint32_t tail = state->tail.load(std::memory_order_relaxed);
+    if (tail == state->head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    command = state->commands[tail % IPC_COMMANDS];
+    command.path[IPC_PATH - 1] = '\0';
+    state->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool SharedMemory::send(const Command& command) {
+    uint32_t head = state->head.load(std::memory_order_relaxed);
+    if (head - state->tail.load(std::memory_order_acquire) == IPC_COMMANDS) {
+        return false;
+    }
+    state->commands[head % IPC_COMMANDS] = command;
+    state->head.store(head + 1, std::memory_order_release);
+    return true;
+}
@@ -1,11 +1,243 @@
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <thread>
 
 #include "chip8.hpp"
+#include "debugger.hpp"
+#include "explore.hpp"
+#include "netplay.hpp"
+#include "util.hpp"
 
-int main() {
+// usage: chip8 [rom] [--headless frames] [--wav file]
+//              [--pacing vsync|sleep|audio] [--frame-delay ms]
+//              [--run-ahead frames] [--hash]
+//              [--scale n] [--upscale nearest|scale2x|scanlines]
+//              [--explore seconds [--threads n] [--crashes dir]]
+//              [--diff n [--seed s] [--inputs file] [--interp]]
+//              [--trace file]
+//              [--debug] [--break addr[:VX==NN]] [--watch addr[:len]]
+//              [--serve name] [--info frames]
+//              [--overlay] [--metrics file] [--no-cache] [--unchecked]
+//              [--record file.y4m|gif|rle [--record-every n]]
+//              [--netplay port --peer host:port [--net-delay frames]
+//               [--net-latency ms] [--net-jitter ms] [--net-loss percent]]
+//
+// --break and --watch can be given any number of times. in a window F5
+// pauses and continues, F10 steps over, F11 steps and shift+F11 steps out
+//
+// --diff runs the --headless frames printing a trace hash every n
+// instructions, for comparing against another core with chip8-diff
+//
+// --overlay shows frame rate and frame times over the display, and --metrics
+// writes the same numbers (and more) as a json line every second
+//
+// --record writes the display of every emulated frame (or every n'th) to a
+// video, picking the format from the extension. with --headless and --inputs
+// it turns a replay into a clip much faster than real time
+//
+// --netplay plays against another chip8 started with the ports swapped, with
+// rollback hiding the round trip. the --net- options fake a bad connection,
+// so two windows on one machine can try it out. --headless with --inputs
+// runs both sides unattended, and their --hash should come out the same
+//
+// --unchecked runs with the Unchecked policy (see Safety in chip8.hpp), for
+// trusted roms. --explore always runs Checked so it can see crashes
+//
+// --no-cache neither reads nor writes ~/.chip8/cache/<rom hash>.c8c, where
+// what loading a rom works out is kept so the next start can skip it
+//
+// --info runs the rom for that many frames and prints its hash, size,
+// platform and final display, which the qt rom browser uses for thumbnails
+int main(int argc, char** argv) {
     int         scale      = 15;
     std::string defaultRom = "INVADERS";
+    int         headless   = 0;
+    std::string wav;
+    Pacing      pacing     = Pacing::Vsync;
+    Upscale     upscale    = Upscale::Nearest;
+    int         frameDelay = 0;
+    int         runAhead   = 0;
+    bool        hash       = false;
+    double      explore    = 0;
+    int         threads    = std::thread::hardware_concurrency();
+    std::string crashes;
+    int         diff       = 0;
+    uint32_t    seed       = 1;
+    std::string inputs;
+    bool        interp     = false;
+    std::string tracePath;
+    bool        debug      = false;
+    Debugger    debugger;
+    std::string serve;
+    int         info       = 0;
+    bool        overlay    = false;
+    std::string metricsPath;
+    std::string videoPath;
+    int         videoEvery = 1;
+    int         netPort    = 0;
+    std::string netPeer;
+    int         netDelay   = NETPLAY_DELAY;
+    int         netLatency = 0;
+    int         netJitter  = 0;
+    double      netLoss    = 0;
+    bool        cached     = true;
+    Safety      safety     = Safety::Checked;
 
-    Chip8 chip8{ defaultRom, scale };
-    chip8.run();
+    for (int a = 1; a < argc; a++) {
+        std::string arg{ argv[a] };
+        if (arg == "--headless" && a + 1 < argc) {
+            headless = std::stoi(argv[++a]);
+        } else if (arg == "--wav" && a + 1 < argc) {
+            wav = argv[++a];
+        } else if (arg == "--explore" && a + 1 < argc) {
+            explore = std::stod(argv[++a]);
+        } else if (arg == "--threads" && a + 1 < argc) {
+            threads = std::stoi(argv[++a]);
+        } else if (arg == "--crashes" && a + 1 < argc) {
+            crashes = argv[++a];
+        } else if (arg == "--diff" && a + 1 < argc) {
+            diff = std::stoi(argv[++a]);
+        } else if (arg == "--seed" && a + 1 < argc) {
+            seed = std::stoul(argv[++a]);
+        } else if (arg == "--inputs" && a + 1 < argc) {
+            inputs = argv[++a];
+        } else if (arg == "--trace" && a + 1 < argc) {
+            tracePath = argv[++a];
+        } else if (arg == "--break" && a + 1 < argc) {
+            debug |= debugger.addBreakpoint(argv[++a]);
+        } else if (arg == "--watch" && a + 1 < argc) {
+            debug |= debugger.addWatch(argv[++a]);
+        } else if (arg == "--record" && a + 1 < argc) {
+            videoPath = argv[++a];
+        } else if (arg == "--record-every" && a + 1 < argc) {
+            videoEvery = std::stoi(argv[++a]);
+        } else if (arg == "--netplay" && a + 1 < argc) {
+            netPort = std::stoi(argv[++a]);
+        } else if (arg == "--peer" && a + 1 < argc) {
+            netPeer = argv[++a];
+        } else if (arg == "--net-delay" && a + 1 < argc) {
+            netDelay = std::stoi(argv[++a]);
+        } else if (arg == "--net-latency" && a + 1 < argc) {
+            netLatency = std::stoi(argv[++a]);
+        } else if (arg == "--net-jitter" && a + 1 < argc) {
+            netJitter = std::stoi(argv[++a]);
+        } else if (arg == "--net-loss" && a + 1 < argc) {
+            netLoss = std::stod(argv[++a]) / 100;
+        } else if (arg == "--unchecked") {
+            safety = Safety::Unchecked;
+        } else if (arg == "--no-cache") {
+            cached = false;
+        } else if (arg == "--overlay") {
+            overlay = true;
+        } else if (arg == "--metrics" && a + 1 < argc) {
+            metricsPath = argv[++a];
+        } else if (arg == "--info" && a + 1 < argc) {
+            info = std::stoi(argv[++a]);
+        } else if (arg == "--serve" && a + 1 < argc) {
+            serve = argv[++a];
+        } else if (arg == "--debug") {
+            debug = true;
+        } else if (arg == "--interp") {
+            interp = true;
+        } else if (arg == "--hash") {
+            hash = true;
+        } else if (arg == "--frame-delay" && a + 1 < argc) {
+            frameDelay = std::stoi(argv[++a]);
+        } else if (arg == "--run-ahead" && a + 1 < argc) {
+            runAhead = std::stoi(argv[++a]);
+        } else if (arg == "--scale" && a + 1 < argc) {
+            scale = std::max(std::stoi(argv[++a]), 1);
+        } else if (arg == "--upscale" && a + 1 < argc) {
+            std::string mode{ argv[++a] };
+            if (mode == "scale2x") {
+                upscale = Upscale::Scale2x;
+            } else if (mode == "scanlines") {
+                upscale = Upscale::Scanlines;
+            }
+        } else if (arg == "--pacing" && a + 1 < argc) {
+            std::string mode{ argv[++a] };
+            if (mode == "sleep") {
+                pacing = Pacing::Sleep;
+            } else if (mode == "audio") {
+                pacing = Pacing::Audio;
+            }
+        } else {
+            defaultRom = arg;
+        }
+    }
+
+    if (explore > 0) {
+        Explorer explorer{ defaultRom, std::max(threads, 1) };
+        explorer.run(explore);
+        explorer.report(crashes);
+        return 0;
+    }
+
+    Chip8 chip8{ defaultRom, scale, cached, safety };
+    chip8.setPacing(pacing);
+    chip8.setFrameDelay(frameDelay);
+    chip8.setRunAhead(runAhead);
+    chip8.setUpscale(upscale);
+    chip8.setOverlay(overlay);
+
+    std::ofstream metricsLog;
+    if (!metricsPath.empty()) {
+        metricsLog.open(metricsPath);
+        if (metricsLog) {
+            chip8.setMetricsLog(&metricsLog);
+        } else {
+            std::cout << "Failed to open metrics log: " << metricsPath
+                      << std::endl;
+        }
+    }
+    if (!wav.empty()) {
+        chip8.record(wav);
+    }
+
+    if (debug) {
+        chip8.setDebugger(&debugger);
+    }
+
+    TraceWriter trace;
+    if (!tracePath.empty() && trace.open(tracePath)) {
+        chip8.setTrace(&trace);
+    }
+
+    VideoWriter video;
+    if (!videoPath.empty() && video.open(videoPath, scale, videoEvery)) {
+        chip8.setVideo(&video);
+    }
+
+    // both sides need the same random numbers
+    Netplay netplay;
+    if (netPort > 0 && netplay.open(netPort, netPeer)) {
+        netplay.setDelay(netDelay);
+        netplay.simulate(netLatency, netJitter, netLoss);
+        chip8.setSeed(seed);
+        chip8.setNetplay(&netplay);
+    }
+
+    if (!serve.empty()) {
+        SharedMemory shm;
+        if (shm.create(serve)) {
+            chip8.serve(shm);
+        }
+    } else if (info > 0) {
+        if (chip8.isLoaded()) {
+            chip8.describe(std::cout, info);
+        }
+    } else if (diff > 0) {
+        chip8.setSeed(seed);
+        chip8.runDiff(std::cout, headless, diff, readInputs(inputs), interp);
+    } else if (headless > 0) {
+        chip8.runHeadless(headless, readInputs(inputs));
+        if (hash) {
+            std::cout << std::hex << chip8.stateHash() << std::dec
+                      << std::endl;
+        }
+    } else {
+        chip8.run();
+    }
 }
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "chip8.hpp"
+#include "metrics.hpp"
+
+// presents per period we make room for. a faster display just grows the
+// buffer once
+#define FRAME_TIMES 1024
+
+Metrics::Metrics() : latest{} {
+    frameTimes.reserve(FRAME_TIMES);
+    sorted.reserve(FRAME_TIMES);
+    start();
+}
+
+void Metrics::start() {
+    begin       = clock::now();
+    window      = begin;
+    marked      = begin;
+    lastPresent = begin;
+
+    spent.fill(0);
+    instructions = 0;
+    frames       = 0;
+    presents     = 0;
+    totalFrames  = 0;
+
+    frameTimes.clear();
+    recent.fill(0);
+    recentAt = 0;
+    latest   = {};
+}
+
+void Metrics::mark(Phase phase) {
+    auto now = clock::now();
+    spent[static_cast<int>(phase)] +=
+        std::chrono::duration<double>(now - marked).count();
+    marked = now;
+}
+
+void Metrics::emulated(int n, uint64_t retired) {
+    frames += n;
+    totalFrames += n;
+    instructions += retired;
+}
+
+void Metrics::presented() {
+    auto  now = clock::now();
+    float ms  = std::chrono::duration<float, std::milli>(now - lastPresent)
+                   .count();
+    lastPresent = now;
+    presents++;
+
+    frameTimes.push_back(ms);
+    recent[recentAt] = ms;
+    recentAt         = (recentAt + 1) % METRICS_GRAPH;
+}
+
+// nearest rank
+float percentile(std::vector<float>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t rank = std::min(values.size() - 1, size_t(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+bool Metrics::sample(MetricsReport& report) {
+    auto   now     = clock::now();
+    double seconds = std::chrono::duration<double>(now - window).count();
+    if (seconds < METRICS_PERIOD) {
+        return false;
+    }
+
+    double elapsed = std::chrono::duration<double>(now - begin).count();
+
+    sorted.assign(frameTimes.begin(), frameTimes.end());
+    latest.time         = elapsed;
+    latest.instructions = instructions / seconds;
+    latest.frames       = frames / seconds;
+    latest.presents     = presents / seconds;
+    latest.p50          = percentile(sorted, 0.50);
+    latest.p95          = percentile(sorted, 0.95);
+    latest.p99          = percentile(sorted, 0.99);
+    latest.worst =
+        sorted.empty() ? 0 : *std::max_element(sorted.begin(), sorted.end());
+    for (int p = 0; p < PHASES; p++) {
+        latest.share[p] = spent[p] / seconds;
+    }
+    latest.drift = (double(totalFrames) / TIMER_RATE - elapsed) * 1000;
+
+    window = now;
+    spent.fill(0);
+    instructions = 0;
+    frames       = 0;
+    presents     = 0;
+    frameTimes.clear();
+
+    report = latest;
+    return true;
+}
+
+const MetricsReport& Metrics::last() const {
+    return latest;
+}
+
+std::array<float, METRICS_GRAPH> Metrics::graph() const {
+    std::array<float, METRICS_GRAPH> ordered;
+    for (int n = 0; n < METRICS_GRAPH; n++) {
+        ordered[n] = recent[(recentAt + n) % METRICS_GRAPH];
+    }
+    return ordered;
+}
+
+// one object per line, so a log can be followed with tail -f and jq
+void Metrics::writeJson(std::ostream& out, const MetricsReport& r) {
+    char line[512];
+    std::snprintf(line,
+                  sizeof(line),
+                  "{\"time\":%.3f,\"ips\":%.0f,\"fps\":%.2f,\"presents\":%.2f,"
+                  "\"frame_ms\":{\"p50\":%.3f,\"p95\":%.3f,\"p99\":%.3f,"
+                  "\"max\":%.3f},\"share\":{\"wait\":%.4f,\"events\":%.4f,"
+                  "\"cpu\":%.4f,\"present\":%.4f},\"drift_ms\":%.3f}",
+                  r.time,
+                  r.instructions,
+                  r.frames,
+                  r.presents,
+                  r.p50,
+                  r.p95,
+                  r.p99,
+                  r.worst,
+                  r.share[static_cast<int>(Phase::Wait)],
+                  r.share[static_cast<int>(Phase::Events)],
+                  r.share[static_cast<int>(Phase::Cpu)],
+                  r.share[static_cast<int>(Phase::Present)],
+                  r.drift);
+    out << line << std::endl;
+}
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include "netplay.hpp"
+
+// no rollback pending, or no frame checked yet
+#define NO_FRAME UINT32_MAX
+
+Netplay::Netplay()
+    : fd{ -1 }, peerAddr{}, peerLen{ 0 }, delay{ NETPLAY_DELAY },
+      latency{ 0 }, jitter{ 0 }, loss{ 0 }, now{ 0 }, remoteNext{ 0 },
+      localNext{ 0 }, peerAck{ 0 }, rollbackFrom{ NO_FRAME }, pending{ 0 },
+      local{}, remote{}, used{}, hashes{}, hashFrames{}, checked{ NO_FRAME },
+      desynced{ false }, rollbacks{ 0 }, resimulated{ 0 }, stalls{ 0 },
+      dropped{ 0 }, rollbackTotal{ 0 }, rollbackWorst{ 0 } {
+    hashFrames.fill(NO_FRAME);
+}
+
+Netplay::~Netplay() {
+    close();
+}
+
+bool Netplay::open(int port, std::string peer) {
+    auto colon = peer.rfind(':');
+    if (colon == std::string::npos) {
+        std::cout << "Netplay peer should be host:port: " << peer << std::endl;
+        return false;
+    }
+    std::string host    = peer.substr(0, colon);
+    std::string service = peer.substr(colon + 1);
+
+    addrinfo  hints{};
+    addrinfo* found{ nullptr };
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &found) != 0) {
+        std::cout << "Failed to resolve netplay peer: " << peer << std::endl;
+        return false;
+    }
+    std::memcpy(&peerAddr, found->ai_addr, found->ai_addrlen);
+    peerLen = found->ai_addrlen;
+    freeaddrinfo(found);
+
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(port);
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 ||
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cout << "Failed to listen for netplay on port " << port
+                  << std::endl;
+        close();
+        return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    // frames before the delay has passed have no input on either side
+    states.resize(NETPLAY_RING);
+    rng.seed(port);
+    localNext = delay;
+    return true;
+}
+
+void Netplay::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void Netplay::setDelay(int frames) {
+    // the peer can be up to 2 predictions and a delay behind, and our input
+    // for every frame from there on has to still be in the ring to resend
+    int most = (NETPLAY_RING - 2 * NETPLAY_PREDICT) / 2 - 1;
+    delay    = std::clamp(frames, 0, most);
+    if (now == 0) {
+        localNext = delay;
+    }
+}
+
+void Netplay::simulate(int ms, int jitterMs, double lost) {
+    latency = std::max(ms, 0);
+    jitter  = std::max(jitterMs, 0);
+    loss    = std::clamp(lost, 0.0, 1.0);
+}
+
+bool Netplay::advance(Chip8& chip8, uint16_t pressed) {
+    receive();
+    pending |= pressed;
+    if (now >= remoteNext + NETPLAY_PREDICT) {
+        stalls++;
+        send();
+        return false;
+    }
+
+    local[(now + delay) % NETPLAY_RING] = pending;
+    localNext                           = now + delay + 1;
+    pending                             = 0;
+
+    rollback(chip8);
+    simulateFrame(chip8, now++);
+    send();
+    return true;
+}
+
+bool Netplay::finish(Chip8& chip8) {
+    auto start = clock::now();
+    auto done  = clock::time_point{};
+    while (true) {
+        receive();
+        rollback(chip8);
+        send();
+
+        auto current = clock::now();
+        if (remoteNext >= now) {
+            // the peer may still be missing the tail of our input
+            if (done == clock::time_point{}) {
+                done = current;
+            }
+            if (peerAck >= now ||
+                current - done > std::chrono::milliseconds(NETPLAY_LINGER)) {
+                return true;
+            }
+        } else if (current - start >
+                   std::chrono::milliseconds(NETPLAY_TIMEOUT)) {
+            std::cout << "Netplay: gave up waiting for the peer at frame "
+                      << remoteNext << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Netplay::report(std::ostream& out) const {
+    char line[160];
+    std::snprintf(line,
+                  sizeof(line),
+                  "Netplay: %u frames, %llu rollbacks (%llu frames run again, "
+                  "%.0fus average, %.0fus worst), %llu stalls",
+                  now,
+                  static_cast<unsigned long long>(rollbacks),
+                  static_cast<unsigned long long>(resimulated),
+                  rollbacks ? rollbackTotal / rollbacks : 0.0,
+                  rollbackWorst,
+                  static_cast<unsigned long long>(stalls));
+    out << line << std::endl;
+}
+
+// a frame is final once every remote input before it is known, and only
+// then is its hash worth comparing with the peer's
+void Netplay::simulateFrame(Chip8& chip8, uint32_t frame) {
+    int slot     = frame % NETPLAY_RING;
+    states[slot] = chip8.save();
+    if (frame <= remoteNext) {
+        hashes[slot]     = chip8.stateHash();
+        hashFrames[slot] = frame;
+        checked          = frame;
+    }
+
+    uint16_t predicted = remoteNext > 0
+                             ? remote[(remoteNext - 1) % NETPLAY_RING]
+                             : 0;
+    used[slot] = frame < remoteNext ? remote[slot] : predicted;
+    chip8.pressKeys(local[slot] | used[slot]);
+    chip8.frame();
+}
+
+void Netplay::rollback(Chip8& chip8) {
+    if (rollbackFrom >= now) {
+        return;
+    }
+
+    auto start = clock::now();
+    chip8.restore(states[rollbackFrom % NETPLAY_RING]);
+    chip8.setMuted(true);
+    chip8.setSpeculative(true);
+    for (uint32_t f = rollbackFrom; f < now; f++) {
+        simulateFrame(chip8, f);
+    }
+    chip8.setSpeculative(false);
+    chip8.setMuted(false);
+
+    double us = std::chrono::duration<double, std::micro>(clock::now() - start)
+                    .count();
+    rollbacks++;
+    resimulated += now - rollbackFrom;
+    rollbackTotal += us;
+    rollbackWorst = std::max(rollbackWorst, us);
+    rollbackFrom  = NO_FRAME;
+}
+
+void Netplay::receive() {
+    NetplayPacket packet;
+    while (fd >= 0) {
+        ssize_t len = recv(fd, &packet, sizeof(packet), 0);
+        if (len < 0) {
+            break;
+        }
+        if (len != sizeof(packet) || packet.magic != NETPLAY_MAGIC ||
+            packet.version != NETPLAY_VERSION ||
+            packet.count > NETPLAY_REDUNDANT) {
+            continue;
+        }
+
+        peerAck = std::max(peerAck, packet.ack);
+
+        // inputs only ever arrive in order, anything past a gap comes again.
+        // nothing is taken that the ring has no room for yet
+        for (int n = 0; n < packet.count; n++) {
+            uint32_t frame = packet.first + n;
+            if (frame < remoteNext) {
+                continue;
+            }
+            if (frame > remoteNext ||
+                frame >= now + NETPLAY_RING - NETPLAY_PREDICT) {
+                break;
+            }
+            int slot     = frame % NETPLAY_RING;
+            remote[slot] = packet.inputs[n];
+            if (frame < now && used[slot] != remote[slot]) {
+                rollbackFrom = std::min(rollbackFrom, frame);
+            }
+            remoteNext++;
+        }
+
+        int slot = packet.checked % NETPLAY_RING;
+        if (!desynced && packet.checked != NO_FRAME &&
+            hashFrames[slot] == packet.checked && hashes[slot] != packet.hash) {
+            std::cout << "Netplay: desync at frame " << packet.checked
+                      << std::endl;
+            desynced = true;
+        }
+    }
+    flush();
+}
+
+void Netplay::send() {
+    NetplayPacket packet{};
+    packet.magic   = NETPLAY_MAGIC;
+    packet.version = NETPLAY_VERSION;
+    packet.first   = peerAck;
+    packet.count   = std::min<uint32_t>(localNext - peerAck, NETPLAY_REDUNDANT);
+    for (int n = 0; n < packet.count; n++) {
+        packet.inputs[n] = local[(peerAck + n) % NETPLAY_RING];
+    }
+    packet.ack     = remoteNext;
+    packet.checked = checked;
+    packet.hash    = hashes[checked % NETPLAY_RING];
+
+    if (loss > 0 && std::uniform_real_distribution<>{}(rng) < loss) {
+        dropped++;
+        return;
+    }
+
+    // packets come out in order of when they are due, so jitter reorders
+    // them like a real network would
+    auto due = clock::now() + std::chrono::milliseconds(latency);
+    if (jitter > 0) {
+        due += std::chrono::milliseconds(
+            std::uniform_int_distribution<>{ 0, jitter }(rng));
+    }
+    auto at = std::upper_bound(
+        outbox.begin(), outbox.end(), due, [](auto due, const Delayed& d) {
+            return due < d.due;
+        });
+    outbox.insert(at, Delayed{ due, packet });
+    flush();
+}
+
+void Netplay::flush() {
+    auto current = clock::now();
+    while (fd >= 0 && !outbox.empty() && outbox.front().due <= current) {
+        sendto(fd,
+               &outbox.front().packet,
+               sizeof(NetplayPacket),
+               0,
+               reinterpret_cast<sockaddr*>(&peerAddr),
+               peerLen);
+        outbox.pop_front();
+    }
+}
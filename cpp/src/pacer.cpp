@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "chip8.hpp"
+#include "pacer.hpp"
+
+// never run more than this many frames to catch up. anything further behind
+// than this (a debugger stop, a dragged window) is dropped instead
+#define MAX_CATCHUP 4
+
+// refresh rates within this fraction of 60hz are treated as exactly 60hz and
+// the small difference is absorbed by audio rate control
+#define SNAP 0.01
+
+// the amount of queued audio we aim for, and how far the resample ratio may be
+// pushed to get there
+#define AUDIO_TARGET (2 * AUDIO_RATE / TIMER_RATE)
+#define MAX_SKEW 0.005
+
+Pacer::Pacer(Pacing mode, Audio& audio, int refresh)
+    : mode{ mode }, audio{ audio }, pending{ 0 } {
+    // audio pacing needs a running device to follow
+    if (mode == Pacing::Audio && !audio.playing()) {
+        this->mode = Pacing::Sleep;
+    }
+
+    period = 1.0 / (refresh > 0 ? refresh : TIMER_RATE);
+    next   = clock::now();
+    last   = next;
+}
+
+int Pacer::wait() {
+    const auto frame = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(1.0 / TIMER_RATE));
+
+    int frames{ 1 };
+
+    switch (mode) {
+        case Pacing::Sleep: {
+            next += frame;
+            auto now = clock::now();
+            if (now < next) {
+                std::this_thread::sleep_until(next);
+            } else {
+                int behind = (now - next) / frame;
+                if (behind < MAX_CATCHUP) {
+                    frames += behind;
+                    next += frame * behind;
+                } else {
+                    next = now;
+                }
+            }
+            break;
+        }
+        case Pacing::Vsync: {
+            // the previous present has already blocked until vblank, so the
+            // time since the last call is one refresh. smooth it so a single
+            // late present doesn't make us run an extra frame
+            auto                          now = clock::now();
+            std::chrono::duration<double> dt  = now - last;
+            last                              = now;
+
+            period = period * 0.95 + std::min(dt.count(), 0.1) * 0.05;
+
+            double ratio = period * TIMER_RATE;
+            if (std::abs(ratio - 1.0) < SNAP) {
+                ratio = 1.0;
+            }
+
+            pending += ratio;
+            frames = std::min(static_cast<int>(pending), MAX_CATCHUP);
+            pending -= std::floor(pending);
+            break;
+        }
+        case Pacing::Audio:
+            while (audio.queued() > AUDIO_TARGET) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            break;
+    }
+
+    adjustAudio();
+    return frames;
+}
+
+void Pacer::adjustAudio() {
+    if (mode == Pacing::Audio || !audio.playing()) {
+        return;
+    }
+
+    double fill = static_cast<double>(audio.queued()) / AUDIO_TARGET;
+    audio.setRatio(1.0 + std::clamp(1.0 - fill, -1.0, 1.0) * MAX_SKEW);
+}
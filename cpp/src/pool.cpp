@@ -0,0 +1,67 @@
+#include <new>
+
+#include "pool.hpp"
+
+Chip8Pool::Chip8Pool(std::string rom, int size)
+    : count{ 0 }, loaded{ false } {
+    instances = static_cast<Chip8*>(::operator new(
+        sizeof(Chip8) * size, std::align_val_t{ alignof(Chip8) }));
+
+    // only count instances that were constructed, so a rom that is missing
+    // stops at the first
+    while (count < size) {
+        Chip8* chip8 = new (&instances[count++]) Chip8{ rom, 1 };
+        if (!chip8->isLoaded()) {
+            return;
+        }
+        chip8->setMuted(true);
+    }
+    if (count == 0) {
+        return;
+    }
+    loaded  = true;
+    initial = instances[0].save();
+
+    free.reserve(size);
+    for (int n = size - 1; n >= 0; n--) {
+        free.push_back(&instances[n]);
+    }
+}
+
+Chip8Pool::~Chip8Pool() {
+    for (int n = 0; n < count; n++) {
+        instances[n].~Chip8();
+    }
+    ::operator delete(instances, std::align_val_t{ alignof(Chip8) });
+}
+
+bool Chip8Pool::isLoaded() const {
+    return loaded;
+}
+
+int Chip8Pool::size() const {
+    return count;
+}
+
+Chip8* Chip8Pool::acquire() {
+    if (free.empty()) {
+        return nullptr;
+    }
+    Chip8* chip8 = free.back();
+    free.pop_back();
+    reset(*chip8);
+    return chip8;
+}
+
+void Chip8Pool::release(Chip8* chip8) {
+    free.push_back(chip8);
+}
+
+void Chip8Pool::reset(Chip8& chip8) const {
+    chip8.restore(initial);
+    chip8.resume();
+}
+
+Chip8& Chip8Pool::operator[](int n) {
+    return instances[n];
+}
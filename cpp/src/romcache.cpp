@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "romcache.hpp"
+
+RomCache::RomCache() : data{ nullptr }, size{ 0 } {}
+
+RomCache::~RomCache() {
+    if (data) {
+        munmap(const_cast<byte*>(data), size);
+    }
+}
+
+bool RomCache::open(uint64_t romHash, uint32_t romSize) {
+    std::string file = path(romHash);
+    if (file.empty()) {
+        return false;
+    }
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        info.st_size != sizeof(RomCacheHeader) + romSize) {
+        ::close(fd);
+        return false;
+    }
+    size = info.st_size;
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const byte*>(mapped);
+
+    const RomCacheHeader& h = header();
+    if (h.magic != ROM_CACHE_MAGIC || h.version != ROM_CACHE_VERSION ||
+        h.romHash != romHash || h.romSize != romSize) {
+        return false;
+    }
+
+    // a damaged entry must not hand the interpreter a fusion it has no case
+    // for
+    for (uint32_t a = 0; a < romSize; a++) {
+        if (data[sizeof(RomCacheHeader) + a] >
+            static_cast<byte>(Fusion::DelayLoop)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const RomCacheHeader& RomCache::header() const {
+    return *reinterpret_cast<const RomCacheHeader*>(data);
+}
+
+const Fusion* RomCache::fusion() const {
+    return reinterpret_cast<const Fusion*>(data + sizeof(RomCacheHeader));
+}
+
+bool RomCache::save(const RomCacheHeader& header, const Fusion* fusion) {
+    std::string file = path(header.romHash);
+    if (file.empty()) {
+        return false;
+    }
+
+    // the directories may well exist already
+    std::string dir = file.substr(0, file.rfind('/'));
+    mkdir(dir.substr(0, dir.rfind('/')).c_str(), 0755);
+    mkdir(dir.c_str(), 0755);
+
+    // the name has to be unique per writer, and workers in one process can
+    // all be saving the same rom at once
+    std::string temp = file + ".XXXXXX";
+    int         fd   = mkstemp(temp.data());
+    if (fd < 0) {
+        return false;
+    }
+    fchmod(fd, 0644);
+    std::FILE* out = fdopen(fd, "wb");
+    if (!out) {
+        ::close(fd);
+        std::remove(temp.c_str());
+        return false;
+    }
+    bool written =
+        std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+        std::fwrite(fusion, 1, header.romSize, out) == header.romSize;
+    written = std::fclose(out) == 0 && written;
+
+    if (!written || std::rename(temp.c_str(), file.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string RomCache::path(uint64_t romHash) {
+    const char* home = std::getenv("HOME");
+    if (!home) {
+        return "";
+    }
+    char name[24];
+    std::snprintf(name,
+                  sizeof(name),
+                  "%016llx.c8c",
+                  static_cast<unsigned long long>(romHash));
+    return std::string{ home } + "/.chip8/cache/" + name;
+}
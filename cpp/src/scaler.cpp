@@ -0,0 +1,173 @@
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCALER_X86
+#endif
+
+#include "scaler.hpp"
+
+// plain fallback, and what the vector kernels have to match
+void expandScalar(const uint8_t*  src,
+                  const int*      edges,
+                  int             width,
+                  const uint32_t* colors,
+                  uint32_t*       out) {
+    for (int x = 0; x < width; x++) {
+        uint32_t color = colors[src[x]];
+        for (int o = edges[x]; o < edges[x + 1]; o++) {
+            out[o] = color;
+        }
+    }
+}
+
+#ifdef SCALER_X86
+// each pixel is filled with whole vector stores, the last of which can run
+// into the next pixel. pixels go left to right so that is always written over
+// again, and the row has SCALER_SLACK pixels spare for the last one
+__attribute__((target("sse2"))) void expandSse2(const uint8_t*  src,
+                                                const int*      edges,
+                                                int             width,
+                                                const uint32_t* colors,
+                                                uint32_t*       out) {
+    for (int x = 0; x < width; x++) {
+        __m128i color = _mm_set1_epi32(colors[src[x]]);
+        for (int o = edges[x]; o < edges[x + 1]; o += 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o), color);
+        }
+    }
+}
+
+__attribute__((target("avx2"))) void expandAvx2(const uint8_t*  src,
+                                                const int*      edges,
+                                                int             width,
+                                                const uint32_t* colors,
+                                                uint32_t*       out) {
+    for (int x = 0; x < width; x++) {
+        __m256i color = _mm256_set1_epi32(colors[src[x]]);
+        for (int o = edges[x]; o < edges[x + 1]; o += 8) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + o), color);
+        }
+    }
+}
+#endif
+
+Scaler::Scaler()
+    : mode{ Upscale::Nearest }, index{}, expand{ expandScalar },
+      kernelName{ "scalar" } {
+#ifdef SCALER_X86
+    if (__builtin_cpu_supports("avx2")) {
+        expand     = expandAvx2;
+        kernelName = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        expand     = expandSse2;
+        kernelName = "sse2";
+    }
+#endif
+}
+
+void Scaler::setMode(Upscale m) {
+    mode = m;
+}
+
+const char* Scaler::kernel() const {
+    return kernelName;
+}
+
+void Scaler::draw(const Planes& display,
+                  const Colors& colors,
+                  int           scale,
+                  uint32_t*     out,
+                  int           pitch) {
+    int width  = SCALER_WIDTH;
+    int height = SCALER_HEIGHT;
+    if (mode == Upscale::Scale2x && scale >= 2) {
+        indexScale2x(display);
+        width *= 2;
+        height *= 2;
+    } else {
+        indexNearest(display);
+    }
+
+    int outWidth  = SCALER_WIDTH * scale;
+    int outHeight = SCALER_HEIGHT * scale;
+
+    edges.resize(width + 1);
+    for (int x = 0; x <= width; x++) {
+        edges[x] = x * outWidth / width;
+    }
+    row.resize(outWidth + SCALER_SLACK);
+
+    bool   scanlines = mode == Upscale::Scanlines && scale >= 2;
+    Colors darkColors;
+    if (scanlines) {
+        dark.resize(outWidth + SCALER_SLACK);
+        for (int c = 0; c < colors.size(); c++) {
+            darkColors[c] =
+                (colors[c] & 0xFF000000) | ((colors[c] >> 1) & 0x007F7F7F);
+        }
+    }
+
+    auto line = [&](int y) {
+        return reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(out) +
+                                           y * pitch);
+    };
+
+    for (int y = 0; y < height; y++) {
+        expand(index[y].data(), edges.data(), width, colors.data(), row.data());
+
+        int top    = y * outHeight / height;
+        int bottom = (y + 1) * outHeight / height - scanlines;
+        for (int r = top; r < bottom; r++) {
+            std::memcpy(line(r), row.data(), outWidth * sizeof(uint32_t));
+        }
+        if (scanlines) {
+            expand(index[y].data(),
+                   edges.data(),
+                   width,
+                   darkColors.data(),
+                   dark.data());
+            std::memcpy(line(bottom), dark.data(), outWidth * sizeof(uint32_t));
+        }
+    }
+}
+
+void Scaler::indexNearest(const Planes& display) {
+    for (int y = 0; y < SCALER_HEIGHT; y++) {
+        for (int x = 0; x < SCALER_WIDTH; x++) {
+            uint8_t c{ 0 };
+            for (int p = 0; p < SCALER_PLANES; p++) {
+                c |= ((display[p][y] >> (SCALER_WIDTH - 1 - x)) & 0x1) << p;
+            }
+            index[y][x] = c;
+        }
+    }
+}
+
+// EPX: each pixel becomes 2x2, and a corner takes the color of the two
+// neighbors it touches when they agree (and the other two don't). off the
+// edge of the display a neighbor is the pixel itself
+void Scaler::indexScale2x(const Planes& display) {
+    indexNearest(display);
+
+    // the 1x image is moved out of the way since it is expanded in place
+    std::array<std::array<uint8_t, SCALER_WIDTH>, SCALER_HEIGHT> src;
+    for (int y = 0; y < SCALER_HEIGHT; y++) {
+        std::memcpy(src[y].data(), index[y].data(), SCALER_WIDTH);
+    }
+
+    for (int y = 0; y < SCALER_HEIGHT; y++) {
+        for (int x = 0; x < SCALER_WIDTH; x++) {
+            uint8_t p = src[y][x];
+            uint8_t a = y > 0 ? src[y - 1][x] : p;
+            uint8_t b = x < SCALER_WIDTH - 1 ? src[y][x + 1] : p;
+            uint8_t c = x > 0 ? src[y][x - 1] : p;
+            uint8_t d = y < SCALER_HEIGHT - 1 ? src[y + 1][x] : p;
+
+            index[2 * y][2 * x]         = c == a && c != d && a != b ? a : p;
+            index[2 * y][2 * x + 1]     = a == b && a != c && b != d ? b : p;
+            index[2 * y + 1][2 * x]     = d == c && d != b && c != a ? c : p;
+            index[2 * y + 1][2 * x + 1] = b == d && b != a && d != c ? d : p;
+        }
+    }
+}
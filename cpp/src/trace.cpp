@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tracefile.hpp"
+
+// chip8-trace: reads traces written by chip8 --trace
+//
+// usage: chip8-trace dump trace [--from n] [--to n] [--pc addr] [--op pattern]
+//                               [--reg x] [--writes]
+//        chip8-trace diff trace-a trace-b
+//        chip8-trace stats trace
+//
+// dump prints every instruction as text, optionally only those matching all
+// of the filters. addresses and registers are hex, and an op pattern is four
+// hex digits with . matching anything (D... is every sprite)
+
+struct Filter {
+    uint64_t    from{ 0 };
+    uint64_t    to{ UINT64_MAX };
+    int         pc{ -1 };
+    uint16_t    opMask{ 0 };
+    uint16_t    opValue{ 0 };
+    int         reg{ -1 };
+    bool        writes{ false };
+
+    bool matches(const TraceRecord& r) const {
+        if (r.index < from || r.index > to) {
+            return false;
+        }
+        if (pc >= 0 && r.pc != pc) {
+            return false;
+        }
+        if (reg >= 0 && !(r.vMask & (1 << reg))) {
+            return false;
+        }
+        if (writes && r.writes == 0) {
+            return false;
+        }
+        return (r.op & opMask) == opValue;
+    }
+
+    // turns a pattern like D.1. into a mask and value
+    void setOp(std::string pattern) {
+        for (int d = 0; d < 4 && d < pattern.size(); d++) {
+            if (pattern[d] != '.') {
+                int shift = 12 - d * 4;
+                opMask |= 0xF << shift;
+                opValue |= std::stoi(pattern.substr(d, 1), nullptr, 16) << shift;
+            }
+        }
+    }
+};
+
+std::string format(const TraceRecord& r) {
+    char        buf[32];
+    std::string line;
+
+    std::snprintf(buf,
+                  sizeof(buf),
+                  "%8llu %5u %04X %04X",
+                  static_cast<unsigned long long>(r.index),
+                  r.frame,
+                  r.pc,
+                  r.op);
+    line += buf;
+    for (int x = 0; x < 16; x++) {
+        if (r.vMask & (1 << x)) {
+            std::snprintf(buf, sizeof(buf), " V%X=%02X", x, r.v[x]);
+            line += buf;
+        }
+    }
+    if (r.flags & TRACE_I) {
+        std::snprintf(buf, sizeof(buf), " I=%04X", r.i);
+        line += buf;
+    }
+    for (int w = 0; w < r.writes; w++) {
+        std::snprintf(buf, sizeof(buf), " [%04X]=%02X", r.addr[w], r.value[w]);
+        line += buf;
+    }
+    return line;
+}
+
+bool same(const TraceRecord& a, const TraceRecord& b) {
+    if (a.pc != b.pc || a.op != b.op || a.v != b.v || a.i != b.i ||
+        a.writes != b.writes) {
+        return false;
+    }
+    for (int w = 0; w < a.writes; w++) {
+        if (a.addr[w] != b.addr[w] || a.value[w] != b.value[w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int dump(std::string path, const Filter& filter) {
+    TraceReader reader;
+    if (!reader.open(path)) {
+        return 1;
+    }
+
+    TraceRecord record;
+    while (reader.next(record)) {
+        if (record.index > filter.to) {
+            break;
+        }
+        if (filter.matches(record)) {
+            std::cout << format(record) << "\n";
+        }
+    }
+    if (!reader.complete()) {
+        std::cout << "trace is truncated" << std::endl;
+    }
+    return 0;
+}
+
+int diff(std::string pathA, std::string pathB) {
+    TraceReader a, b;
+    if (!a.open(pathA) || !b.open(pathB)) {
+        return 1;
+    }
+
+    TraceRecord ra, rb;
+    while (true) {
+        bool moreA = a.next(ra);
+        bool moreB = b.next(rb);
+        if (!moreA && !moreB) {
+            std::cout << "traces match" << std::endl;
+            return 0;
+        }
+        if (moreA && moreB && same(ra, rb)) {
+            continue;
+        }
+
+        std::cout << "first divergence:" << std::endl;
+        std::cout << "  a: " << (moreA ? format(ra) : "<end of trace>")
+                  << std::endl;
+        std::cout << "  b: " << (moreB ? format(rb) : "<end of trace>")
+                  << std::endl;
+        return 1;
+    }
+}
+
+int stats(std::string path) {
+    TraceReader reader;
+    if (!reader.open(path)) {
+        return 1;
+    }
+
+    std::vector<uint64_t> hits(0x10000);
+    TraceRecord           record;
+    uint64_t              count{ 0 };
+    uint64_t              writes{ 0 };
+    uint32_t              frames{ 0 };
+    while (reader.next(record)) {
+        hits[record.pc]++;
+        writes += record.writes;
+        frames = record.frame;
+        count++;
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    std::fseek(file, 0, SEEK_END);
+    long bytes = std::ftell(file);
+    std::fclose(file);
+
+    std::cout << count << " instructions over " << frames + 1 << " frames, "
+              << writes << " memory writes, "
+              << (count ? double(bytes) / count : 0) << " bytes/instruction"
+              << std::endl;
+
+    std::vector<int> pcs(hits.size());
+    for (int a = 0; a < pcs.size(); a++) {
+        pcs[a] = a;
+    }
+    std::partial_sort(pcs.begin(),
+                      pcs.begin() + 10,
+                      pcs.end(),
+                      [&](int a, int b) { return hits[a] > hits[b]; });
+
+    std::cout << "hottest pcs:" << std::endl;
+    for (int n = 0; n < 10 && hits[pcs[n]] > 0; n++) {
+        char line[32];
+        std::snprintf(line,
+                      sizeof(line),
+                      "  %04X %llu",
+                      pcs[n],
+                      static_cast<unsigned long long>(hits[pcs[n]]));
+        std::cout << line << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::string command{ argc > 2 ? argv[1] : "" };
+
+    if (command == "dump") {
+        Filter filter;
+        for (int a = 3; a < argc; a++) {
+            std::string arg{ argv[a] };
+            if (arg == "--writes") {
+                filter.writes = true;
+            } else if (arg == "--from" && a + 1 < argc) {
+                filter.from = std::stoull(argv[++a]);
+            } else if (arg == "--to" && a + 1 < argc) {
+                filter.to = std::stoull(argv[++a]);
+            } else if (arg == "--pc" && a + 1 < argc) {
+                filter.pc = std::stoi(argv[++a], nullptr, 16);
+            } else if (arg == "--op" && a + 1 < argc) {
+                filter.setOp(argv[++a]);
+            } else if (arg == "--reg" && a + 1 < argc) {
+                filter.reg = std::stoi(argv[++a], nullptr, 16);
+            }
+        }
+        return dump(argv[2], filter);
+    }
+    if (command == "diff" && argc > 3) {
+        return diff(argv[2], argv[3]);
+    }
+    if (command == "stats") {
+        return stats(argv[2]);
+    }
+
+    std::cout << "usage: chip8-trace dump|diff|stats trace [...]" << std::endl;
+    return 1;
+}
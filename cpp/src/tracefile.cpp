@@ -0,0 +1,331 @@
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tracefile.hpp"
+
+// largest possible record: head, opcode, register mask and values, i, and
+// the memory writes
+#define MAX_RECORD (3 + 2 + 3 + 16 + 3 + 3 + TRACE_MAX_WRITES * 4)
+
+#define HEADER_SIZE (4 + 1 + 2 + 2 + 16)
+
+uint32_t zigzag(int32_t value) {
+    return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+int32_t unzigzag(uint32_t value) {
+    return int32_t(value >> 1) ^ -int32_t(value & 0x1);
+}
+
+TraceWriter::TraceWriter()
+    : file{ nullptr }, pending{ false }, stopping{ false }, used{ 0 },
+      backUsed{ 0 }, pc{ 0 }, op{ 0 }, expected{ 0 }, lastI{ 0 }, lastV{},
+      writes{ 0 } {}
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+bool TraceWriter::open(std::string path) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to open trace: " << path << std::endl;
+        return false;
+    }
+
+    front.resize(TRACE_BUFFER);
+    back.resize(TRACE_BUFFER);
+    used     = 0;
+    pending  = false;
+    stopping = false;
+    thread   = std::thread{ &TraceWriter::flushLoop, this };
+    return true;
+}
+
+void TraceWriter::close() {
+    if (!file) {
+        return;
+    }
+
+    swap();
+    {
+        std::lock_guard<std::mutex> guard{ lock };
+        stopping = true;
+    }
+    ready.notify_all();
+    thread.join();
+
+    std::fclose(file);
+    file = nullptr;
+}
+
+void TraceWriter::header(uint16_t pc,
+                         uint16_t i,
+                         const std::array<byte, 16>& v) {
+    std::memcpy(&front[used], TRACE_MAGIC, 4);
+    used += 4;
+    front[used++] = TRACE_VERSION;
+    front[used++] = pc;
+    front[used++] = pc >> 8;
+    front[used++] = i;
+    front[used++] = i >> 8;
+    std::memcpy(&front[used], v.data(), v.size());
+    used += v.size();
+
+    expected = pc;
+    lastI    = i;
+    lastV    = v;
+}
+
+void TraceWriter::begin(uint16_t at, uint16_t opcode) {
+    pc     = at;
+    op     = opcode;
+    writes = 0;
+}
+
+void TraceWriter::write(uint16_t at, byte val) {
+    if (writes < TRACE_MAX_WRITES) {
+        addr[writes]  = at;
+        value[writes] = val;
+        writes++;
+    }
+}
+
+void TraceWriter::end(uint16_t i, const std::array<byte, 16>& v) {
+    if (TRACE_BUFFER - used < MAX_RECORD) {
+        swap();
+    }
+
+    uint16_t vMask{ 0 };
+    if (v != lastV) {
+        for (int r = 0; r < 16; r++) {
+            vMask |= (v[r] != lastV[r]) << r;
+        }
+    }
+
+    byte flags = (vMask ? TRACE_V : 0) | (i != lastI ? TRACE_I : 0) |
+                 (writes ? TRACE_MEM : 0);
+    varint((zigzag(int16_t(pc - expected)) << 4) | flags);
+    front[used++] = op >> 8;
+    front[used++] = op;
+
+    if (vMask) {
+        varint(vMask);
+        for (int r = 0; r < 16; r++) {
+            if (vMask & (1 << r)) {
+                front[used++] = v[r];
+            }
+        }
+        lastV = v;
+    }
+    if (writes) {
+        varint(writes);
+        uint16_t base = lastI;
+        for (int w = 0; w < writes; w++) {
+            varint(zigzag(int16_t(addr[w] - base)));
+            front[used++] = value[w];
+            base          = addr[w];
+        }
+    }
+    if (i != lastI) {
+        varint(zigzag(int16_t(i - lastI)));
+        lastI = i;
+    }
+
+    // F000 NNNN is the only 4 byte instruction
+    expected = pc + (op == 0xF000 ? 4 : 2);
+}
+
+void TraceWriter::frame() {
+    if (TRACE_BUFFER - used < MAX_RECORD) {
+        swap();
+    }
+    varint(TRACE_FRAME);
+}
+
+void TraceWriter::varint(uint32_t value) {
+    while (value >= 0x80) {
+        front[used++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    front[used++] = value;
+}
+
+// hands the filled buffer to the writer thread, first waiting for it to
+// finish with the previous one
+void TraceWriter::swap() {
+    std::unique_lock<std::mutex> guard{ lock };
+    ready.wait(guard, [this] { return !pending; });
+    std::swap(front, back);
+    backUsed = used;
+    used     = 0;
+    pending  = true;
+    guard.unlock();
+    ready.notify_all();
+}
+
+void TraceWriter::flushLoop() {
+    std::unique_lock<std::mutex> guard{ lock };
+    while (true) {
+        ready.wait(guard, [this] { return pending || stopping; });
+        if (!pending) {
+            return;
+        }
+
+        guard.unlock();
+        std::fwrite(back.data(), 1, backUsed, file);
+        guard.lock();
+
+        pending = false;
+        ready.notify_all();
+    }
+}
+
+TraceReader::TraceReader()
+    : data{ nullptr }, size{ 0 }, pos{ 0 }, truncated{ false }, index{ 0 },
+      frame{ 0 }, expected{ 0 }, i{ 0 }, v{} {}
+
+TraceReader::~TraceReader() {
+    if (data) {
+        munmap(const_cast<byte*>(data), size);
+    }
+}
+
+bool TraceReader::open(std::string path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Failed to open trace: " << path << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    fstat(fd, &info);
+    size = info.st_size;
+    if (size < HEADER_SIZE) {
+        std::cout << "Not a trace: " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cout << "Failed to map trace: " << path << std::endl;
+        return false;
+    }
+    data = static_cast<const byte*>(mapped);
+
+    if (std::memcmp(data, TRACE_MAGIC, 4) != 0 || data[4] != TRACE_VERSION) {
+        std::cout << "Not a trace: " << path << std::endl;
+        return false;
+    }
+    expected = data[5] | (data[6] << 8);
+    i        = data[7] | (data[8] << 8);
+    std::memcpy(v.data(), data + 9, v.size());
+    pos = HEADER_SIZE;
+    return true;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    uint32_t head;
+    while (varint(head)) {
+        byte flags = head & 0xF;
+        if (flags & TRACE_FRAME) {
+            frame++;
+            continue;
+        }
+
+        record.index = index;
+        record.frame = frame;
+        record.pc    = expected + unzigzag(head >> 4);
+        record.flags = flags;
+        if (size - pos < 2) {
+            truncated = true;
+            return false;
+        }
+        record.op = (data[pos] << 8) | data[pos + 1];
+        pos += 2;
+
+        uint32_t field;
+        record.vMask = 0;
+        if (flags & TRACE_V) {
+            if (!varint(field)) {
+                truncated = true;
+                return false;
+            }
+            record.vMask = field;
+            for (int r = 0; r < 16; r++) {
+                if (record.vMask & (1 << r)) {
+                    if (pos == size) {
+                        truncated = true;
+                        return false;
+                    }
+                    v[r] = data[pos++];
+                }
+            }
+        }
+
+        record.writes = 0;
+        if (flags & TRACE_MEM) {
+            uint32_t count;
+            if (!varint(count) || count > TRACE_MAX_WRITES) {
+                truncated = true;
+                return false;
+            }
+            uint16_t base = i;
+            for (uint32_t w = 0; w < count; w++) {
+                if (!varint(field) || pos == size) {
+                    truncated = true;
+                    return false;
+                }
+                base            = base + unzigzag(field);
+                record.addr[w]  = base;
+                record.value[w] = data[pos++];
+            }
+            record.writes = count;
+        }
+
+        if (flags & TRACE_I) {
+            if (!varint(field)) {
+                truncated = true;
+                return false;
+            }
+            i += unzigzag(field);
+        }
+
+        record.v = v;
+        record.i = i;
+        expected = record.pc + (record.op == 0xF000 ? 4 : 2);
+        index++;
+        return true;
+    }
+
+    return false;
+}
+
+bool TraceReader::complete() const {
+    return !truncated;
+}
+
+bool TraceReader::varint(uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos == size) {
+            truncated = truncated || shift > 0;
+            return false;
+        }
+        byte b = data[pos++];
+        value |= uint32_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    truncated = true;
+    return false;
+}
@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+
+#include "video.hpp"
+
+// gif codes are at most 12 bits
+#define LZW_CODES 4096
+
+// gif delays are in hundredths of a second. frame times are rounded from the
+// start of the recording rather than frame to frame, so they never drift
+static uint32_t centiseconds(uint32_t frame) {
+    return (uint64_t(frame) * 100 + VIDEO_RATE / 2) / VIDEO_RATE;
+}
+
+static uint8_t pixel(const VideoWriter::Planes& display, int x, int y) {
+    uint8_t c{ 0 };
+    for (int p = 0; p < VIDEO_PLANES; p++) {
+        c |= ((display[p][y] >> (VIDEO_WIDTH - 1 - x)) & 0x1) << p;
+    }
+    return c;
+}
+
+static bool endsWith(const std::string& s, const std::string& end) {
+    return s.size() >= end.size() &&
+           s.compare(s.size() - end.size(), end.size(), end) == 0;
+}
+
+VideoWriter::VideoWriter()
+    : file{ nullptr }, format{ VideoFormat::Y4m }, scale{ 1 }, every{ 1 },
+      palette{}, head{ 0 }, count{ 0 }, stopping{ false }, started{ false },
+      last{}, lastNumber{ 0 }, held{ false }, heldNumber{ 0 }, heldRect{} {}
+
+VideoWriter::~VideoWriter() {
+    close();
+}
+
+bool VideoWriter::open(std::string path, int s, int n) {
+    if (endsWith(path, ".y4m")) {
+        format = VideoFormat::Y4m;
+    } else if (endsWith(path, ".gif")) {
+        format = VideoFormat::Gif;
+    } else if (endsWith(path, ".rle")) {
+        format = VideoFormat::Rle;
+    } else {
+        std::cout << "Unknown video format (use .y4m, .gif or .rle): "
+                  << path << std::endl;
+        return false;
+    }
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to open video: " << path << std::endl;
+        return false;
+    }
+
+    scale = format == VideoFormat::Rle ? 1 : std::max(s, 1);
+    every = std::max(n, 1);
+    out.reserve(3 * VIDEO_WIDTH * VIDEO_HEIGHT * scale * scale + 64);
+    if (format == VideoFormat::Gif) {
+        lzwTable.resize(LZW_CODES * (1 << VIDEO_PLANES));
+        heldData.reserve(VIDEO_WIDTH * VIDEO_HEIGHT * scale * scale);
+    }
+
+    head     = 0;
+    count    = 0;
+    stopping = false;
+    started  = false;
+    held     = false;
+    thread   = std::thread{ &VideoWriter::encodeLoop, this };
+    return true;
+}
+
+void VideoWriter::close() {
+    if (!file) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard{ lock };
+        stopping = true;
+    }
+    ready.notify_all();
+    thread.join();
+
+    finish();
+    std::fclose(file);
+    file = nullptr;
+}
+
+void VideoWriter::setPalette(const Colors& colors) {
+    palette = colors;
+}
+
+void VideoWriter::push(uint32_t frame, const Planes& display) {
+    if (!file || frame % every != 0) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> guard{ lock };
+    space.wait(guard, [&]() { return count < VIDEO_QUEUE; });
+    Frame& slot  = queue[(head + count) % VIDEO_QUEUE];
+    slot.number  = frame;
+    slot.display = display;
+    count++;
+    guard.unlock();
+    ready.notify_one();
+}
+
+void VideoWriter::encodeLoop() {
+    Frame frame;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard{ lock };
+            ready.wait(guard, [&]() { return count > 0 || stopping; });
+            if (count == 0) {
+                return;
+            }
+            frame = queue[head];
+            head  = (head + 1) % VIDEO_QUEUE;
+            count--;
+        }
+        space.notify_one();
+        encode(frame);
+    }
+}
+
+void VideoWriter::encode(const Frame& frame) {
+    switch (format) {
+        case VideoFormat::Y4m:
+            if (!started) {
+                char header[64];
+                int  len = std::snprintf(header,
+                                         sizeof(header),
+                                         "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 "
+                                         "C444\n",
+                                         VIDEO_WIDTH * scale,
+                                         VIDEO_HEIGHT * scale,
+                                         VIDEO_RATE,
+                                         every);
+                out.insert(out.end(), header, header + len);
+            }
+            y4mFrame(frame.display);
+            break;
+        case VideoFormat::Gif:
+            if (!started) {
+                gifHeader();
+            }
+            gifFrame(frame);
+            break;
+        case VideoFormat::Rle:
+            if (!started) {
+                out.insert(out.end(), VIDEO_RLE_MAGIC, VIDEO_RLE_MAGIC + 4);
+                out.push_back(VIDEO_RLE_VERSION);
+                out.push_back(VIDEO_WIDTH);
+                out.push_back(VIDEO_HEIGHT);
+                out.push_back(VIDEO_PLANES);
+            }
+            rleFrame(frame);
+            break;
+    }
+    started    = true;
+    last       = frame.display;
+    lastNumber = frame.number;
+    flush();
+}
+
+void VideoWriter::finish() {
+    if (format == VideoFormat::Gif && started) {
+        gifFlush(lastNumber + every);
+        out.push_back(0x3B);
+    }
+    flush();
+}
+
+// limited range bt.601, which is what players assume for y4m
+void VideoWriter::y4mFrame(const Planes& display) {
+    std::array<std::array<uint8_t, 1 << VIDEO_PLANES>, 3> yuv;
+    for (int c = 0; c < palette.size(); c++) {
+        int r = palette[c][0], g = palette[c][1], b = palette[c][2];
+        yuv[0][c] = 16 + (66 * r + 129 * g + 25 * b + 128) / 256;
+        yuv[1][c] = 128 + (-38 * r - 74 * g + 112 * b + 128) / 256;
+        yuv[2][c] = 128 + (112 * r - 94 * g - 18 * b + 128) / 256;
+    }
+
+    const char* tag = "FRAME\n";
+    out.insert(out.end(), tag, tag + 6);
+
+    int width = VIDEO_WIDTH * scale;
+    for (int component = 0; component < 3; component++) {
+        for (int y = 0; y < VIDEO_HEIGHT; y++) {
+            size_t at = out.size();
+            out.resize(at + width * scale);
+            uint8_t* line = &out[at];
+            for (int x = 0; x < VIDEO_WIDTH; x++) {
+                std::memset(line + x * scale,
+                            yuv[component][pixel(display, x, y)],
+                            scale);
+            }
+            for (int r = 1; r < scale; r++) {
+                std::memcpy(line + r * width, line, width);
+            }
+        }
+    }
+}
+
+void VideoWriter::gifHeader() {
+    int width  = VIDEO_WIDTH * scale;
+    int height = VIDEO_HEIGHT * scale;
+
+    const char* magic = "GIF89a";
+    out.insert(out.end(), magic, magic + 6);
+    out.insert(out.end(),
+               { uint8_t(width), uint8_t(width >> 8), uint8_t(height),
+                 uint8_t(height >> 8) });
+
+    // global color table of 1 << VIDEO_PLANES colors
+    out.insert(out.end(), { uint8_t(0xF0 | (VIDEO_PLANES - 1)), 0, 0 });
+    for (auto& color : palette) {
+        out.insert(out.end(), color.begin(), color.end());
+    }
+
+    // loop forever
+    const char* loop = "NETSCAPE2.0";
+    out.insert(out.end(), { 0x21, 0xFF, 0x0B });
+    out.insert(out.end(), loop, loop + 11);
+    out.insert(out.end(), { 0x03, 0x01, 0x00, 0x00, 0x00 });
+}
+
+// a frame is only written once the next different one turns up (or the
+// recording ends), since that is when its delay is known
+void VideoWriter::gifFrame(const Frame& frame) {
+    if (started && frame.display == last) {
+        return;
+    }
+
+    int left = VIDEO_WIDTH, top = VIDEO_HEIGHT, right = -1, bottom = -1;
+    for (int y = 0; y < VIDEO_HEIGHT; y++) {
+        uint64_t changed = started ? 0 : ~uint64_t{ 0 };
+        for (int p = 0; p < VIDEO_PLANES; p++) {
+            changed |= frame.display[p][y] ^ last[p][y];
+        }
+        if (changed) {
+            top    = std::min(top, y);
+            bottom = y;
+            left   = std::min(left, std::countl_zero(changed));
+            right =
+                std::max(right, VIDEO_WIDTH - 1 - std::countr_zero(changed));
+        }
+    }
+
+    gifFlush(frame.number);
+
+    held       = true;
+    heldNumber = frame.number;
+    heldRect   = { left * scale,
+                   top * scale,
+                   (right - left + 1) * scale,
+                   (bottom - top + 1) * scale };
+    heldData.clear();
+    for (int sy = top * scale; sy < (bottom + 1) * scale; sy++) {
+        for (int sx = left * scale; sx < (right + 1) * scale; sx++) {
+            heldData.push_back(pixel(frame.display, sx / scale, sy / scale));
+        }
+    }
+}
+
+void VideoWriter::gifFlush(uint32_t until) {
+    if (!held) {
+        return;
+    }
+    held = false;
+
+    // graphic control: drawn over the previous frame, shown for delay
+    uint32_t delay = centiseconds(until) - centiseconds(heldNumber);
+    out.insert(out.end(),
+               { 0x21, 0xF9, 0x04, 0x04, uint8_t(delay), uint8_t(delay >> 8),
+                 0x00, 0x00 });
+
+    out.push_back(0x2C);
+    for (int v : heldRect) {
+        out.insert(out.end(), { uint8_t(v), uint8_t(v >> 8) });
+    }
+    out.push_back(0x00);
+    lzw(heldData);
+}
+
+// gif's variable width lzw, packed lsb first into blocks of up to 255 bytes
+void VideoWriter::lzw(const std::vector<uint8_t>& pixels) {
+    const int      minWidth = VIDEO_PLANES;
+    const uint16_t clear    = 1 << minWidth;
+    const uint16_t end      = clear + 1;
+    const int      colors   = 1 << VIDEO_PLANES;
+
+    out.push_back(minWidth);
+    size_t block = out.size();
+    out.push_back(0);
+
+    uint32_t bits  = 0;
+    int      used  = 0;
+    int      width = minWidth + 1;
+
+    auto byteOut = [&](uint8_t b) {
+        if (out[block] == 255) {
+            block = out.size();
+            out.push_back(0);
+        }
+        out.push_back(b);
+        out[block]++;
+    };
+    auto code = [&](uint16_t c) {
+        bits |= uint32_t(c) << used;
+        used += width;
+        while (used >= 8) {
+            byteOut(bits);
+            bits >>= 8;
+            used -= 8;
+        }
+    };
+
+    // codes below end are never anyone's child, so 0 marks an empty slot
+    std::fill(lzwTable.begin(), lzwTable.end(), 0);
+    uint16_t next = end;
+    code(clear);
+
+    uint16_t current = pixels[0];
+    for (size_t n = 1; n < pixels.size(); n++) {
+        uint8_t   p     = pixels[n];
+        uint16_t& child = lzwTable[current * colors + p];
+        if (child) {
+            current = child;
+            continue;
+        }
+        code(current);
+        child = ++next;
+        if (next >= (1 << width)) {
+            width++;
+        }
+        if (next == LZW_CODES - 1) {
+            code(clear);
+            std::fill(lzwTable.begin(), lzwTable.end(), 0);
+            width = minWidth + 1;
+            next  = end;
+        }
+        current = p;
+    }
+    code(current);
+    code(end);
+    if (used > 0) {
+        byteOut(bits);
+    }
+
+    // an empty block ends the data, and the last one may already be empty
+    if (out[block] != 0) {
+        out.push_back(0);
+    }
+}
+
+void VideoWriter::rleFrame(const Frame& frame) {
+    if (started && frame.display == last) {
+        return;
+    }
+
+    // heldNumber is the frame of the previous record
+    varint(frame.number - (started ? heldNumber : 0));
+    heldNumber = frame.number;
+
+    for (int p = 0; p < VIDEO_PLANES; p++) {
+        bool     set = false;
+        uint32_t run = 0;
+        for (int y = 0; y < VIDEO_HEIGHT; y++) {
+            uint64_t row  = frame.display[p][y];
+            int      left = VIDEO_WIDTH;
+            while (left > 0) {
+                int n = set ? std::countl_one(row) : std::countl_zero(row);
+                n     = std::min(n, left);
+                run += n;
+                left -= n;
+                row = n < 64 ? row << n : 0;
+                if (left > 0) {
+                    varint(run);
+                    run = 0;
+                    set = !set;
+                }
+            }
+        }
+        varint(run);
+    }
+}
+
+void VideoWriter::varint(uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(value | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+}
+
+void VideoWriter::flush() {
+    if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), file);
+        out.clear();
+    }
+}
@@ -1,6 +1,8 @@
 package cmd
 
 import (
+	"os"
+
 	"github.com/spf13/cobra"
 	"github.com/yetibob/chip8/vm"
 )
@@ -18,12 +20,45 @@ var (
 			err = vm.Load(romFile)
 			panicErr(err)
 
+			diff, err := cmd.Flags().GetInt("diff")
+			panicErr(err)
+			if diff > 0 {
+				err = runDiff(cmd, &vm, diff)
+				panicErr(err)
+				return
+			}
+
 			err = vm.Start(10)
 			panicErr(err)
 		},
 	}
 )
 
+// runDiff runs headless printing trace hashes for chip8-diff
+func runDiff(cmd *cobra.Command, c *vm.Chip8, every int) error {
+	frames, err := cmd.Flags().GetInt("frames")
+	if err != nil {
+		return err
+	}
+	seed, err := cmd.Flags().GetUint32("seed")
+	if err != nil {
+		return err
+	}
+	inputFile, err := cmd.Flags().GetString("inputs")
+	if err != nil {
+		return err
+	}
+
+	var inputs []uint16
+	if inputFile != "" {
+		inputs, err = vm.ReadInputs(inputFile)
+		if err != nil {
+			return err
+		}
+	}
+	return c.RunDiff(os.Stdout, frames, every, seed, inputs)
+}
+
 func panicErr(err error) {
 	if err != nil {
 		panic(err)
@@ -39,6 +74,11 @@ func init() {
 	cobra.OnInitialize(initConfig)
 	rootCmd.PersistentFlags().StringP("rom", "r", "", "rom file to regen")
 	rootCmd.MarkPersistentFlagRequired("rom")
+
+	rootCmd.Flags().Int("diff", 0, "run headless, printing a trace hash every n instructions")
+	rootCmd.Flags().Int("frames", 600, "frames to run with --diff")
+	rootCmd.Flags().Uint32("seed", 1, "rng seed for --diff")
+	rootCmd.Flags().String("inputs", "", "file of per frame key masks for --diff")
 }
 
 func initConfig() {
@@ -0,0 +1,119 @@
+package vm
+
+import (
+	"bufio"
+	"errors"
+	"fmt"
+	"hash/fnv"
+	"io"
+	"math/rand"
+	"os"
+	"strconv"
+	"strings"
+)
+
+// instructions run between timer ticks, the same as the C++ core
+const cyclesPerFrame = 10
+
+// random returns the next byte for CXKK. headless runs use bits 23-30 of
+// minstd_rand0, which is what the C++ core does, so a seed produces the same
+// sequence in both
+func (c *Chip8) random() byte {
+	if !c.headless {
+		return byte(rand.Intn(256))
+	}
+	c.rng = uint32(uint64(c.rng) * 16807 % 2147483647)
+	return byte(c.rng >> 23)
+}
+
+// pollInput is FX0A without blocking on sdl. the instruction simply runs
+// again until a key is down, and the lowest key down wins
+func (c *Chip8) pollInput(x byte) {
+	for k := byte(0); k < 16; k++ {
+		if c.keys[k] {
+			c.v[x] = k
+			c.keys[k] = false
+			return
+		}
+	}
+	c.pc -= 2
+}
+
+// RunDiff runs the loaded rom without a window for differential testing
+// against the C++ core. inputs[f] is the key mask for frame f (bit n being
+// key n), and every n instructions a line of "count pc i hash" is written to
+// w. hash is a running FNV-1a over pc and i (little endian), V0-VF and the
+// display, a byte per pixel row by row, matching the C++ core's --diff
+func (c *Chip8) RunDiff(w io.Writer, frames, every int, seed uint32, inputs []uint16) error {
+	if c.romFile == "" {
+		return errors.New("No ROM loaded")
+	}
+	if every <= 0 {
+		return errors.New("diff interval must be positive")
+	}
+
+	// seeding the same way as std::minstd_rand0
+	c.headless = true
+	c.rng = seed % 2147483647
+	if c.rng == 0 {
+		c.rng = 1
+	}
+
+	out := bufio.NewWriter(w)
+	defer out.Flush()
+
+	h := fnv.New64a()
+	count := 0
+	for f := 0; f < frames; f++ {
+		var mask uint16
+		if f < len(inputs) {
+			mask = inputs[f]
+		}
+		for k := byte(0); k < 16; k++ {
+			c.keys[k] = (mask>>k)&0x1 == 0x1
+		}
+
+		for n := 0; n < cyclesPerFrame; n++ {
+			handleOp(c, c.mem[c.pc:c.pc+2])
+			count++
+			if count%every != 0 {
+				continue
+			}
+
+			h.Write([]byte{byte(c.pc), byte(c.pc >> 8), byte(c.i), byte(c.i >> 8)})
+			h.Write(c.v[:])
+			for _, row := range c.display {
+				h.Write(row[:])
+			}
+			fmt.Fprintf(out, "%d %04x %04x %016x\n", count, c.pc, c.i, h.Sum64())
+		}
+
+		if c.dt > 0 {
+			c.dt--
+		}
+		if c.st > 0 {
+			c.st--
+		}
+	}
+	return nil
+}
+
+// ReadInputs reads per frame key masks, one hex number per line. anything
+// else (like the fault at the top of a C++ explorer crash file) is skipped
+func ReadInputs(path string) ([]uint16, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	var inputs []uint16
+	scanner := bufio.NewScanner(f)
+	for scanner.Scan() {
+		mask, err := strconv.ParseUint(strings.TrimSpace(scanner.Text()), 16, 16)
+		if err == nil {
+			inputs = append(inputs, uint16(mask))
+		}
+	}
+	return inputs, scanner.Err()
+}
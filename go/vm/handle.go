@@ -2,7 +2,6 @@ package vm
 
 import (
 	"fmt"
-	"math/rand"
 )
 
 func handleOp(c *Chip8, buf []byte) {
@@ -107,7 +106,7 @@ func handleOp(c *Chip8, buf []byte) {
 	case 0xB:
 		c.pc = addr + uint16(c.v[0])
 	case 0xC:
-		c.v[x] = byte(rand.Intn(256)) & kk
+		c.v[x] = c.random() & kk
 	case 0xD:
 		var erased bool
 
@@ -183,7 +182,11 @@ func handleOp(c *Chip8, buf []byte) {
 		case 0x07:
 			c.v[x] = c.dt
 		case 0x0A:
-			c.v[x] = c.waitForInput()
+			if c.headless {
+				c.pollInput(x)
+			} else {
+				c.v[x] = c.waitForInput()
+			}
 		case 0x15:
 			c.dt = c.v[x]
 		case 0x18:
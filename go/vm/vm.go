@@ -105,6 +105,11 @@ type Chip8 struct {
 	// scale is used to determine the size of the display and pixels
 	scale   int32
 	running bool
+
+	// headless runs (see RunDiff) have no sdl, and use the same rng and
+	// non blocking FX0A as the C++ core so the two can be compared
+	headless bool
+	rng      uint32
 }
 
 func (c *Chip8) waitForInput() byte {
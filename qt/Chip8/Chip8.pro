@@ -8,18 +8,23 @@ CONFIG += c++2a
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# the emulator runs as a separate process, shared memory is the only link
+INCLUDEPATH += ../../cpp/include
+
 SOURCES += \
-    chip8.cpp \
-    emucanvas.cpp \
+    ../../cpp/src/ipc.cpp \
+    emuclient.cpp \
+    emuwidget.cpp \
     main.cpp \
-    sdlcanvas.cpp \
+    rombrowser.cpp \
     util.cpp \
     window.cpp
 
 HEADERS += \
-    chip8.h \
-    emucanvas.h \
-    sdlcanvas.h \
+    ../../cpp/include/ipc.hpp \
+    emuclient.h \
+    emuwidget.h \
+    rombrowser.h \
     util.h \
     window.h
 
@@ -30,5 +35,3 @@ FORMS += \
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
-
-LIBS += -lSDL2
@@ -0,0 +1,106 @@
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QStandardPaths>
+
+#include "emuclient.h"
+
+EmuClient::EmuClient(QObject *parent) : QObject(parent), lastFrame(0) {
+    name = QString("chip8-%1").arg(QCoreApplication::applicationPid());
+
+    // ~60hz, matching the emulator's presents
+    timer.setInterval(16);
+    connect(&timer, &QTimer::timeout, this, &EmuClient::poll);
+    connect(&process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, &EmuClient::finished);
+}
+
+EmuClient::~EmuClient() {
+    quit();
+}
+
+void EmuClient::launch(const QString &rom) {
+    if (process.state() != QProcess::NotRunning) {
+        send(CommandType::Load, 0, rom);
+        return;
+    }
+
+    process.setProcessChannelMode(QProcess::ForwardedChannels);
+    process.start(emulatorPath(), { rom, "--serve", name });
+    timer.start();
+}
+
+void EmuClient::quit() {
+    if (process.state() == QProcess::NotRunning) {
+        return;
+    }
+    send(CommandType::Quit);
+    if (!process.waitForFinished(1000)) {
+        process.kill();
+    }
+    shm.close();
+}
+
+void EmuClient::pause() {
+    send(CommandType::Pause);
+}
+
+void EmuClient::resume() {
+    send(CommandType::Resume);
+}
+
+void EmuClient::step() {
+    send(CommandType::Step);
+}
+
+void EmuClient::reset() {
+    send(CommandType::Reset);
+}
+
+void EmuClient::key(uint8_t key, bool down) {
+    send(down ? CommandType::KeyDown : CommandType::KeyUp, key);
+}
+
+bool EmuClient::isAttached() const {
+    return shm.isOpen();
+}
+
+QString EmuClient::emulatorPath() {
+    // the emulator binary is looked for next to the app first, then on PATH
+    QString emulator = QStandardPaths::findExecutable("chip8", { QCoreApplication::applicationDirPath() });
+    if (emulator.isEmpty()) {
+        emulator = QStandardPaths::findExecutable("chip8");
+    }
+    return emulator;
+}
+
+void EmuClient::poll() {
+    // the emulator creates the segment once it is up
+    if (!shm.isOpen() && !shm.attach(name.toStdString())) {
+        return;
+    }
+
+    quint64 frame = 0;
+    if (shm.read([&](const Snapshot &s) { frame = s.frame; }) && frame != lastFrame) {
+        lastFrame = frame;
+        emit updated(frame);
+    }
+}
+
+void EmuClient::finished() {
+    timer.stop();
+    shm.close();
+    lastFrame = 0;
+    emit stopped();
+}
+
+void EmuClient::send(CommandType type, uint8_t key, const QString &path) {
+    if (!shm.isOpen()) {
+        return;
+    }
+
+    Command command{};
+    command.type = type;
+    command.key  = key;
+    std::strncpy(command.path, path.toLocal8Bit().constData(), IPC_PATH - 1);
+    shm.send(command);
+}
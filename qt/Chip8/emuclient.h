@@ -0,0 +1,62 @@
+#ifndef EMUCLIENT_H
+#define EMUCLIENT_H
+
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+
+#include "ipc.hpp"
+
+// Runs the emulator as a separate process (chip8 --serve) and talks to it
+// through shared memory (see cpp/include/ipc.hpp). Nothing here waits on the
+// emulator: state is polled at display rate and commands are fire and forget,
+// so a stuck emulator can't freeze the GUI and a GUI crash leaves the
+// emulator running.
+class EmuClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EmuClient(QObject *parent = nullptr);
+    ~EmuClient();
+
+    // starts the emulator with rom, or loads rom into the running one
+    void launch(const QString &rom);
+    void quit();
+
+    void pause();
+    void resume();
+    void step();
+    void reset();
+    void key(uint8_t key, bool down);
+
+    bool isAttached() const;
+
+    // the chip8 binary, next to the app or on PATH. empty if there is none
+    static QString emulatorPath();
+
+    // reads the latest snapshot in place. see SharedMemory::read
+    template <typename F> bool read(F &&use) const {
+        return shm.isOpen() && shm.read(std::forward<F>(use));
+    }
+
+signals:
+    // a new frame was published
+    void updated(quint64 frame);
+    void stopped();
+
+private slots:
+    void poll();
+    void finished();
+
+private:
+    QProcess     process;
+    QTimer       timer;
+    SharedMemory shm;
+    QString      name;
+    quint64      lastFrame;
+
+    void send(CommandType type, uint8_t key = 0, const QString &path = QString());
+};
+
+#endif // EMUCLIENT_H
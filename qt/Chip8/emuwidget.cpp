@@ -0,0 +1,41 @@
+#include <QImage>
+#include <QPainter>
+
+#include "emuwidget.h"
+
+EmuWidget::EmuWidget(EmuClient *emu, QWidget *parent) : QWidget(parent), emu(emu), displayHash(0) {
+    planeColors[0] = { qRgb(0, 0, 0), qRgb(0, 255, 255) };
+    planeColors[1] = { qRgb(0, 0, 0), qRgb(255, 0, 255) };
+
+    // every pixel is painted, so Qt doesn't need to clear behind us
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    connect(emu, &EmuClient::updated, this, &EmuWidget::frameUpdated);
+    connect(emu, &EmuClient::stopped, this, [this] { update(); });
+}
+
+void EmuWidget::frameUpdated() {
+    quint64 hash = displayHash;
+    emu->read([&](const Snapshot &s) { hash = s.displayHash; });
+    if (hash != displayHash) {
+        displayHash = hash;
+        update();
+    }
+}
+
+void EmuWidget::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+
+    // drawn inside the read so the images never outlive a consistent view of
+    // the snapshot. a torn read just paints again
+    emu->read([&](const Snapshot &s) {
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        painter.fillRect(rect(), Qt::black);
+        painter.setCompositionMode(QPainter::CompositionMode_Plus);
+        for (int p = 0; p < IPC_PLANES; p++) {
+            QImage plane(s.display[p].data(), IPC_WIDTH, IPC_HEIGHT, IPC_WIDTH / 8, QImage::Format_Mono);
+            plane.setColorTable(planeColors[p]);
+            painter.drawImage(rect(), plane);
+        }
+    });
+}
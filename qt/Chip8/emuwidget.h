@@ -0,0 +1,33 @@
+#ifndef EMUWIDGET_H
+#define EMUWIDGET_H
+
+#include <QWidget>
+
+#include "emuclient.h"
+
+// Draws the emulator's display straight out of shared memory. Each bitplane
+// is wrapped in a 1-bit QImage without copying and scaled up by drawImage.
+// The widget only repaints when the display actually changed.
+class EmuWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit EmuWidget(EmuClient *emu, QWidget *parent = nullptr);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private slots:
+    void frameUpdated();
+
+private:
+    EmuClient *emu;
+    quint64    displayHash;
+
+    // a color for each plane. they are added together where planes overlap,
+    // which gives the same 4 colors as the SDL frontend
+    QVector<QRgb> planeColors[IPC_PLANES];
+};
+
+#endif // EMUWIDGET_H
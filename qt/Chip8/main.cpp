@@ -1,7 +1,5 @@
 #include <QApplication>
 
-#include "chip8.h"
-#include "emucanvas.h"
 #include "window.h"
 
 int main(int argc, char **argv)
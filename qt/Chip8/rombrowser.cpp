@@ -0,0 +1,225 @@
+#include <QDialogButtonBox>
+#include <QDir>
+#include <QFile>
+#include <QPixmap>
+#include <QProcess>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QVBoxLayout>
+
+#include "emuclient.h"
+#include "ipc.hpp"
+#include "rombrowser.h"
+
+// frames a rom runs for before its display is captured, 5 seconds worth
+#define THUMBNAIL_FRAMES 300
+
+// ms a single rom gets before it is given up on
+#define THUMBNAIL_TIMEOUT 5000
+
+#define THUMBNAIL_WIDTH (IPC_WIDTH * 2)
+#define THUMBNAIL_HEIGHT (IPC_HEIGHT * 2)
+
+static QString cacheDir() {
+    return QDir::homePath() + "/.chip8/cache";
+}
+
+// the emulator's rom hash (fnv1a in util.hpp), so cache entries line up with
+// what chip8 --info reports
+static QString romHash(const QByteArray &rom) {
+    quint64 hash = 0xcbf29ce484222325;
+    for (char c : rom) {
+        hash ^= quint8(c);
+        hash *= 0x100000001b3;
+    }
+    return QString("%1").arg(hash, 16, 16, QChar('0'));
+}
+
+// the display line of chip8 --info as an image, with the SDL frontend's colors
+static QImage thumbnail(const QStringList &words) {
+    static const QRgb palette[] = { qRgb(0, 0, 0), qRgb(0, 255, 255), qRgb(255, 0, 255), qRgb(255, 255, 255) };
+
+    QImage image(IPC_WIDTH, IPC_HEIGHT, QImage::Format_RGB32);
+    if (words.size() != IPC_PLANES * IPC_HEIGHT) {
+        image.fill(Qt::black);
+        return image;
+    }
+    for (int y = 0; y < IPC_HEIGHT; y++) {
+        quint64 plane0 = words[y].toULongLong(nullptr, 16);
+        quint64 plane1 = words[IPC_HEIGHT + y].toULongLong(nullptr, 16);
+        auto    line   = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < IPC_WIDTH; x++) {
+            int shift = IPC_WIDTH - 1 - x;
+            line[x]   = palette[((plane0 >> shift) & 0x1) | (((plane1 >> shift) & 0x1) << 1)];
+        }
+    }
+    return image;
+}
+
+static RomInfo parse(const QByteArray &text) {
+    RomInfo info;
+    for (const QByteArray &line : text.split('\n')) {
+        QStringList words = QString::fromLatin1(line).split(' ', Qt::SkipEmptyParts);
+        if (words.isEmpty()) {
+            continue;
+        }
+        QString key = words.takeFirst();
+        if (key == "hash" && !words.isEmpty()) {
+            info.hash = words[0];
+        } else if (key == "size" && !words.isEmpty()) {
+            info.size = words[0].toLongLong();
+        } else if (key == "profile" && !words.isEmpty()) {
+            info.profile = words[0];
+        } else if (key == "display") {
+            info.thumbnail = thumbnail(words);
+        }
+    }
+    return info;
+}
+
+// describes one rom, from the cache when it has been seen before and by
+// running the emulator otherwise. runs on the browser's pool
+class DescribeJob : public QRunnable
+{
+public:
+    DescribeJob(RomBrowser *browser, int row, const QString &path, const QString &emulator,
+                std::shared_ptr<std::atomic<bool>> cancelled)
+        : browser(browser), row(row), path(path), emulator(emulator), cancelled(cancelled) {}
+
+    void run() override {
+        if (*cancelled) {
+            return;
+        }
+        QFile rom(path);
+        if (!rom.open(QIODevice::ReadOnly)) {
+            return;
+        }
+        QByteArray bytes = rom.readAll();
+        QString    hash  = romHash(bytes);
+
+        QString    cached = cacheDir() + "/" + hash + ".info";
+        QByteArray text;
+        QFile      cache(cached);
+        if (cache.open(QIODevice::ReadOnly)) {
+            text = cache.readAll();
+        } else if (!emulator.isEmpty()) {
+            QProcess process;
+            process.start(emulator, { path, "--info", QString::number(THUMBNAIL_FRAMES) });
+            if (process.waitForFinished(THUMBNAIL_TIMEOUT)) {
+                text = process.readAllStandardOutput();
+            } else {
+                process.kill();
+                process.waitForFinished();
+            }
+
+            // written whole or not at all, so a crash never leaves a bad entry
+            if (text.contains("\ndisplay")) {
+                QSaveFile save(cached);
+                if (save.open(QIODevice::WriteOnly)) {
+                    save.write(text);
+                    save.commit();
+                }
+            }
+        }
+
+        RomInfo info = parse(text);
+        info.hash    = hash;
+        info.size    = bytes.size();
+        if (!*cancelled) {
+            QMetaObject::invokeMethod(browser, "described", Qt::QueuedConnection, Q_ARG(int, row), Q_ARG(RomInfo, info));
+        }
+    }
+
+private:
+    RomBrowser *browser;
+    int         row;
+    QString     path;
+    QString     emulator;
+
+    std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
+RomBrowser::RomBrowser(const QString &romDir, QWidget *parent)
+    : QDialog(parent), cancelled(std::make_shared<std::atomic<bool>>(false)) {
+    qRegisterMetaType<RomInfo>();
+    setWindowTitle(tr("Roms in %1").arg(romDir));
+    resize(720, 480);
+
+    list = new QListWidget;
+    list->setViewMode(QListView::IconMode);
+    list->setIconSize(QSize(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT));
+    list->setGridSize(QSize(THUMBNAIL_WIDTH + 24, THUMBNAIL_HEIGHT + 32));
+    list->setResizeMode(QListView::Adjust);
+    list->setMovement(QListView::Static);
+    list->setUniformItemSizes(true);
+
+    details = new QLabel;
+
+    auto buttons = new QDialogButtonBox(QDialogButtonBox::Open | QDialogButtonBox::Cancel);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(list, &QListWidget::itemActivated, this, &QDialog::accept);
+    connect(list, &QListWidget::currentRowChanged, this, &RomBrowser::showDetails);
+
+    auto layout = new QVBoxLayout(this);
+    layout->addWidget(list);
+    layout->addWidget(details);
+    layout->addWidget(buttons);
+
+    QDir().mkpath(cacheDir());
+
+    QPixmap blank(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT);
+    blank.fill(Qt::black);
+
+    // every rom is listed right away and gets its thumbnail when its job is
+    // done. nothing on this thread touches the roms themselves
+    QString emulator = EmuClient::emulatorPath();
+    QDir    dir(romDir);
+    for (const QFileInfo &file : dir.entryInfoList(QDir::Files, QDir::Name)) {
+        auto item = new QListWidgetItem(QIcon(blank), file.fileName(), list);
+        item->setData(Qt::UserRole, file.absoluteFilePath());
+        pool.start(new DescribeJob(this, list->count() - 1, file.absoluteFilePath(), emulator, cancelled));
+    }
+    infos.resize(list->count());
+}
+
+RomBrowser::~RomBrowser() {
+    // jobs already running have to finish before this goes away, since they
+    // post their results to it. the rest are dropped
+    *cancelled = true;
+    pool.clear();
+    pool.waitForDone();
+}
+
+QString RomBrowser::selected() const {
+    auto item = list->currentItem();
+    return item ? item->data(Qt::UserRole).toString() : QString();
+}
+
+void RomBrowser::described(int row, const RomInfo &info) {
+    infos[row] = info;
+    if (!info.thumbnail.isNull()) {
+        list->item(row)->setIcon(QPixmap::fromImage(info.thumbnail.scaled(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT)));
+    }
+    if (row == list->currentRow()) {
+        showDetails();
+    }
+}
+
+void RomBrowser::showDetails() {
+    int row = list->currentRow();
+    if (row < 0) {
+        details->clear();
+        return;
+    }
+    const RomInfo &info = infos[row];
+    if (info.hash.isEmpty()) {
+        details->setText(tr("%1  (running...)").arg(list->item(row)->text()));
+        return;
+    }
+    details->setText(tr("%1  %2 bytes  %3  %4")
+                         .arg(list->item(row)->text())
+                         .arg(info.size)
+                         .arg(info.profile.isEmpty() ? tr("unknown") : info.profile)
+                         .arg(info.hash));
+}
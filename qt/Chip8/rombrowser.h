@@ -0,0 +1,55 @@
+#ifndef ROMBROWSER_H
+#define ROMBROWSER_H
+
+#include <QDialog>
+#include <QImage>
+#include <QLabel>
+#include <QListWidget>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+
+// what the emulator found out about a rom by running it (chip8 --info)
+struct RomInfo
+{
+    QString hash;
+    qint64  size = 0;
+    QString profile;
+    QImage  thumbnail;
+};
+
+// Lists every rom in a directory with a thumbnail of what it shows after a
+// few seconds of play. Thumbnails are made on a thread pool, each job running
+// the emulator headless in its own process, and show up as they finish so
+// the dialog is usable straight away. Results are cached on disk by rom hash,
+// so only new or changed roms are ever run again.
+class RomBrowser : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit RomBrowser(const QString &romDir, QWidget *parent = nullptr);
+    ~RomBrowser();
+
+    // the rom picked, or empty
+    QString selected() const;
+
+private slots:
+    void described(int row, const RomInfo &info);
+    void showDetails();
+
+private:
+    QListWidget *list;
+    QLabel      *details;
+    QThreadPool  pool;
+
+    // set when the dialog goes away so queued jobs skip their work
+    std::shared_ptr<std::atomic<bool>> cancelled;
+
+    QVector<RomInfo> infos;
+};
+
+Q_DECLARE_METATYPE(RomInfo)
+
+#endif // ROMBROWSER_H
@@ -1,18 +1,18 @@
-#include "emucanvas.h"
+#include "rombrowser.h"
 #include "window.h"
 #include "ui_window.h"
 
 #include <QFileDialog>
+#include <QKeyEvent>
 #include <QVBoxLayout>
 
-Window::Window(int scale, QWidget *parent) : QMainWindow(parent) , ui(new Ui::window), scale(scale) {
+Window::Window(int scale, QWidget *parent) : QMainWindow(parent) , ui(new Ui::window), scale(scale), paused(false) {
     romDir = QDir::homePath() + "/.chip8/roms";
     rom = romDir + "/INVADERS";
     QString message = qPrintable(rom);
     statusBar()->showMessage(message);
 
-    QWidget *widget = new QWidget;
-    setCentralWidget(widget);
+    setCentralWidget(new EmuWidget(&emu));
 
     // QWidget *topFiller = new QWidget;
     // topFiller->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
@@ -31,10 +31,18 @@ Window::Window(int scale, QWidget *parent) : QMainWindow(parent) , ui(new Ui::wi
 
     // widget->setLayout(layout);
 
+    keymap = {
+        { Qt::Key_1, 0x1 }, { Qt::Key_2, 0x2 }, { Qt::Key_3, 0x3 }, { Qt::Key_4, 0xC },
+        { Qt::Key_Q, 0x4 }, { Qt::Key_W, 0x5 }, { Qt::Key_E, 0x6 }, { Qt::Key_R, 0xD },
+        { Qt::Key_A, 0x7 }, { Qt::Key_S, 0x8 }, { Qt::Key_D, 0x9 }, { Qt::Key_F, 0xE },
+        { Qt::Key_Z, 0xA }, { Qt::Key_X, 0x0 }, { Qt::Key_C, 0xB }, { Qt::Key_V, 0xF },
+    };
+    connect(&emu, &EmuClient::updated, this, &Window::showState);
+
     createActions();
     createMenus();
     int addHeight = 3*scale;
-    setFixedSize(D_WIDTH*scale, D_HEIGHT*scale+addHeight);
+    setFixedSize(IPC_WIDTH*scale, IPC_HEIGHT*scale+addHeight);
     // ui->setupUi(this);
 }
 
@@ -43,10 +51,6 @@ Window::~Window()
     delete ui;
 }
 
-void Window::setCanvas(SDLCanvas *sdlCanvas) {
-   canvas = sdlCanvas;
-}
-
 void Window::setRomDirectory() {
     romDir = QFileDialog::getExistingDirectory(this, tr("Rom Directory"), QDir::homePath(), QFileDialog::ShowDirsOnly);
     QString message = tr(qPrintable(romDir));
@@ -54,32 +58,61 @@ void Window::setRomDirectory() {
 }
 
 void Window::selectRom() {
-    rom = QFileDialog::getOpenFileName(this, tr("Rom"), romDir);
+    RomBrowser browser(romDir, this);
+    if (browser.exec() != QDialog::Accepted || browser.selected().isEmpty()) {
+        return;
+    }
+    rom = browser.selected();
     QString message = tr(qPrintable(rom));
     statusBar()->showMessage(message);
 }
 
+// The emulator runs as its own process and is driven through shared memory
+// (see EmuClient), so the SDL loop never blocks Qt and debugging features
+// can read its state directly
 void Window::launchEmu() {
-    // TODO:INVESTIGATE
-    // Alright. This is where things get tricky. Either figure out how to create an OpenGL OR SDL context
-    // in QT or launch as separate process...maybe try out both?
-    // Single Process:
-    //     How to include emulator
-    //         Include in compilation?
-    //         Static/Shared/Dynamic Library type thing?
-    //         Is there some way to to dynamic/runtime loading?
-
-    // This below implementation is kind of garbage. The SDL loop blocks QT completely.
-    // The model of calling the Chip8 emu "as is" works better as a separate process using some kind of IPC
-    // The best bet for doing it this bad way is to either completely rewrite Chip8 to use QT/OpenGL directly
-    // OR heavily modify the Chip8 emulator to play well with QT and live in EmuCanvas (IE, get rid of emu.run()
-    // and have the emu loop occur via EmuCanvas::OnUpdate()
-
-    EmuCanvas canvas(centralWidget(), pos(), QSize(D_WIDTH*scale, D_HEIGHT*scale));
-    canvas.show();
-
-    // Multi Process:
-    //     Will need IPC to enable debugging and other currently unknown features
+    paused = false;
+    emu.launch(rom);
+}
+
+void Window::togglePause() {
+    paused = !paused;
+    if (paused) {
+        emu.pause();
+    } else {
+        emu.resume();
+    }
+}
+
+void Window::showState() {
+    QString message;
+    emu.read([&](const Snapshot &s) {
+        message = QString("frame %1  pc %2  i %3  %4 fps  %5 ips  p99 %6ms%7")
+                      .arg(s.frame)
+                      .arg(s.pc, 4, 16, QChar('0'))
+                      .arg(s.i, 4, 16, QChar('0'))
+                      .arg(s.framesPerSecond, 0, 'f', 0)
+                      .arg(s.instructionsPerSecond, 0, 'f', 0)
+                      .arg(s.frameTimeP99, 0, 'f', 1)
+                      .arg(s.paused ? "  (paused)" : "");
+    });
+    statusBar()->showMessage(message);
+}
+
+void Window::keyPressEvent(QKeyEvent *event) {
+    if (keymap.contains(event->key()) && !event->isAutoRepeat()) {
+        emu.key(keymap[event->key()], true);
+        return;
+    }
+    QMainWindow::keyPressEvent(event);
+}
+
+void Window::keyReleaseEvent(QKeyEvent *event) {
+    if (keymap.contains(event->key()) && !event->isAutoRepeat()) {
+        emu.key(keymap[event->key()], false);
+        return;
+    }
+    QMainWindow::keyReleaseEvent(event);
 }
 
 void Window::createActions() {
@@ -97,6 +130,27 @@ void Window::createActions() {
     launch->setShortcut(QKeySequence(tr("Ctrl+L")));
     launch->setStatusTip(tr("Starts Emulator with chosen rom"));
     connect(launch, &QAction::triggered, this, &Window::launchEmu);
+
+    pause = new QAction(tr("&Pause/Resume"), this);
+    pause->setShortcut(QKeySequence(Qt::Key_F5));
+    pause->setStatusTip(tr("Pauses or resumes the emulator"));
+    connect(pause, &QAction::triggered, this, &Window::togglePause);
+
+    step = new QAction(tr("&Step"), this);
+    step->setShortcut(QKeySequence(Qt::Key_F11));
+    step->setStatusTip(tr("Runs a single instruction"));
+    connect(step, &QAction::triggered, this, [this] {
+        paused = true;
+        emu.step();
+    });
+
+    reset = new QAction(tr("&Reset"), this);
+    reset->setShortcut(QKeySequence(tr("Ctrl+Shift+L")));
+    reset->setStatusTip(tr("Restarts the current rom"));
+    connect(reset, &QAction::triggered, this, [this] {
+        paused = false;
+        emu.reset();
+    });
 }
 
 void Window::createMenus() {
@@ -105,4 +159,9 @@ void Window::createMenus() {
     fileMenu->addAction(setRom);
     fileMenu->addAction(launch);
     fileMenu->addSeparator();
+
+    debugMenu = menuBar()->addMenu(tr("&Debug"));
+    debugMenu->addAction(pause);
+    debugMenu->addAction(step);
+    debugMenu->addAction(reset);
 }
@@ -1,11 +1,12 @@
 #ifndef WINDOW_H
 #define WINDOW_H
 
-#include "chip8.h"
-#include "sdlcanvas.h"
+#include "emuclient.h"
+#include "emuwidget.h"
 
 #include <QMainWindow>
 #include <QLabel>
+#include <QMap>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class window; }
@@ -20,11 +21,16 @@ public:
     ~Window();
 
     QString rom;
-    void setCanvas(SDLCanvas *);
+protected:
+    void keyPressEvent(QKeyEvent *event) override;
+    void keyReleaseEvent(QKeyEvent *event) override;
+
 private slots:
     void setRomDirectory();
     void selectRom();
     void launchEmu();
+    void togglePause();
+    void showState();
 
 private:
     Ui::window *ui;
@@ -34,11 +40,21 @@ private:
     void createMenus();
 
     QMenu *fileMenu;
+    QMenu *debugMenu;
     QAction *setRomDir;
     QAction *setRom;
     QAction *launch;
+    QAction *pause;
+    QAction *step;
+    QAction *reset;
     // QLabel *infoLabel;
 
     QString romDir;
+
+    EmuClient emu;
+    bool paused;
+
+    // qt key to chip8 key, laid out like the sdl frontend
+    QMap<int, uint8_t> keymap;
 };
 #endif // WINDOW_H